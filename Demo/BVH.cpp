@@ -0,0 +1,276 @@
+#include <Demo/BVH.h>
+#include <Demo/Common/Base.h>
+#include <Demo/Common/Log.h>
+#include <Demo/Mesh.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+
+namespace Demo {
+constexpr uint32_t BIN_COUNT = 16;
+constexpr uint32_t MAX_LEAF_SIZE = 8;
+
+// Traversal stack in bvh.glsl must be deeper than that
+constexpr uint32_t MAX_DEPTH = 48;
+
+// Cost of visiting a node relative to intersecting one primitive
+constexpr float TRAVERSAL_COST = 1.0f;
+
+// Padded to a SIMD register, so growing is a single min and max
+struct AABB {
+    Vector4 min = Vector4(Vector3(std::numeric_limits<float>::max()), 0.0f);
+    Vector4 max = Vector4(Vector3(-std::numeric_limits<float>::max()), 0.0f);
+
+    void grow(Vector4 point)
+    {
+        min = Demo::min(min, point);
+        max = Demo::max(max, point);
+    }
+
+    void grow(const AABB& other)
+    {
+        min = Demo::min(min, other.min);
+        max = Demo::max(max, other.max);
+    }
+
+    // Half of the surface area, which is enough to compare costs
+    float area() const
+    {
+        auto extent = max - min;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+};
+
+static AABB primitive_bounds(const BVHPrimitive& primitive)
+{
+    AABB bounds;
+
+    switch (primitive.type) {
+    case PrimitiveType::Triangle:
+        bounds.grow(Vector4(primitive.a, 0.0f));
+        bounds.grow(Vector4(primitive.b, 0.0f));
+        bounds.grow(Vector4(primitive.c, 0.0f));
+        break;
+    case PrimitiveType::Box:
+        bounds.grow(Vector4(primitive.a - primitive.b, 0.0f));
+        bounds.grow(Vector4(primitive.a + primitive.b, 0.0f));
+        break;
+    }
+
+    return bounds;
+}
+
+void BVH::add_triangle(Vector3 a, Vector3 b, Vector3 c, Vector3 albedo)
+{
+    m_primitives.push_back({
+        .a = a,
+        .type = PrimitiveType::Triangle,
+        .b = b,
+        .c = c,
+        .albedo = albedo,
+    });
+}
+
+void BVH::add_box(Vector3 center, Vector3 radius, Vector3 albedo)
+{
+    m_primitives.push_back({
+        .a = center,
+        .type = PrimitiveType::Box,
+        .b = radius,
+        .c = Vector3(0.0f),
+        .albedo = albedo,
+    });
+}
+
+void BVH::add_mesh(const Mesh& mesh, Vector3 albedo)
+{
+    const auto& data = mesh.data();
+
+    // Indexed meshes reference welded vertices, other meshes list triangle corners in order
+    auto position = [&](size_t corner) {
+        size_t vertex = mesh.indexed() ? mesh.indices()[corner] : corner;
+        return Vector3(data[vertex * VERTEX_FLOATS + 0], data[vertex * VERTEX_FLOATS + 1], data[vertex * VERTEX_FLOATS + 2]);
+    };
+
+    for (size_t corner = 0; corner + 2 < mesh.index_count(); corner += 3) {
+        add_triangle(position(corner), position(corner + 1), position(corner + 2), albedo);
+    }
+}
+
+void BVH::build()
+{
+    ASSERT(!m_primitives.empty(), "BVH can't be empty");
+
+    auto primitive_count = static_cast<uint32_t>(m_primitives.size());
+
+    // Bounds are also split into coordinate arrays, so centroids are computed SIMD_WIDTH at a time
+    std::vector<AABB> bounds(primitive_count);
+    std::vector<float> coordinates(9 * static_cast<size_t>(primitive_count));
+    auto coordinate_array = [&](size_t index) { return coordinates.data() + index * primitive_count; };
+
+    BoxArrays boxes = {
+        .min = {coordinate_array(0), coordinate_array(1), coordinate_array(2)},
+        .max = {coordinate_array(3), coordinate_array(4), coordinate_array(5)},
+    };
+    PointArrays centers = {coordinate_array(6), coordinate_array(7), coordinate_array(8)};
+
+    for (uint32_t i = 0; i < primitive_count; i++) {
+        bounds[i] = primitive_bounds(m_primitives[i]);
+        boxes.min.x[i] = bounds[i].min.x;
+        boxes.min.y[i] = bounds[i].min.y;
+        boxes.min.z[i] = bounds[i].min.z;
+        boxes.max.x[i] = bounds[i].max.x;
+        boxes.max.y[i] = bounds[i].max.y;
+        boxes.max.z[i] = bounds[i].max.z;
+    }
+
+    box_centers(boxes, centers, primitive_count);
+
+    std::vector<Vector4> centroids(primitive_count);
+    for (uint32_t i = 0; i < primitive_count; i++) {
+        centroids[i] = Vector4(centers.x[i], centers.y[i], centers.z[i], 0.0f);
+    }
+
+    std::vector<uint32_t> indices(primitive_count);
+    std::iota(indices.begin(), indices.end(), 0);
+
+    m_nodes.clear();
+    m_nodes.reserve(2 * primitive_count - 1);
+    m_nodes.push_back({
+        .left_first = 0,
+        .primitive_count = primitive_count,
+    });
+
+    struct Task {
+        uint32_t node;
+        uint32_t depth;
+    };
+
+    std::vector<Task> stack = {{0, 0}};
+
+    while (!stack.empty()) {
+        auto task = stack.back();
+        stack.pop_back();
+
+        uint32_t first = m_nodes[task.node].left_first;
+        uint32_t count = m_nodes[task.node].primitive_count;
+
+        AABB node_bounds;
+        AABB centroid_bounds;
+        for (uint32_t i = first; i < first + count; i++) {
+            node_bounds.grow(bounds[indices[i]]);
+            centroid_bounds.grow(centroids[indices[i]]);
+        }
+
+        m_nodes[task.node].min = node_bounds.min.xyz();
+        m_nodes[task.node].max = node_bounds.max.xyz();
+
+        if (count <= 1 || task.depth >= MAX_DEPTH) {
+            continue;
+        }
+
+        auto bin_of = [&](uint32_t primitive, size_t axis) {
+            float extent = centroid_bounds.max[axis] - centroid_bounds.min[axis];
+            float offset = (centroids[primitive][axis] - centroid_bounds.min[axis]) / extent;
+            return std::min(static_cast<uint32_t>(offset * BIN_COUNT), BIN_COUNT - 1);
+        };
+
+        float best_cost = std::numeric_limits<float>::max();
+        size_t best_axis = 0;
+        uint32_t best_split = 0;
+
+        for (size_t axis = 0; axis < 3; axis++) {
+            if (centroid_bounds.max[axis] - centroid_bounds.min[axis] <= 0.0f) {
+                continue;
+            }
+
+            std::array<AABB, BIN_COUNT> bins = {};
+            std::array<uint32_t, BIN_COUNT> bin_counts = {};
+
+            for (uint32_t i = first; i < first + count; i++) {
+                auto bin = bin_of(indices[i], axis);
+                bins[bin].grow(bounds[indices[i]]);
+                bin_counts[bin]++;
+            }
+
+            // Sweep from both sides to evaluate every plane between bins in linear time
+            std::array<float, BIN_COUNT - 1> left_areas = {};
+            std::array<uint32_t, BIN_COUNT - 1> left_counts = {};
+
+            AABB left;
+            uint32_t left_count = 0;
+            for (uint32_t split = 0; split < BIN_COUNT - 1; split++) {
+                left.grow(bins[split]);
+                left_count += bin_counts[split];
+                left_areas[split] = left_count > 0 ? left.area() : 0.0f;
+                left_counts[split] = left_count;
+            }
+
+            AABB right;
+            uint32_t right_count = 0;
+            for (uint32_t split = BIN_COUNT - 1; split > 0; split--) {
+                right.grow(bins[split]);
+                right_count += bin_counts[split];
+
+                if (left_counts[split - 1] == 0 || right_count == 0) {
+                    continue;
+                }
+
+                float cost = left_counts[split - 1] * left_areas[split - 1] + right_count * right.area();
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best_axis = axis;
+                    best_split = split;
+                }
+            }
+        }
+
+        // All centroids coincide, so there is no way to separate primitives
+        if (best_split == 0) {
+            continue;
+        }
+
+        float node_area = node_bounds.area();
+        float leaf_cost = count * node_area;
+        float split_cost = TRAVERSAL_COST * node_area + best_cost;
+
+        if (count <= MAX_LEAF_SIZE && split_cost >= leaf_cost) {
+            continue;
+        }
+
+        auto middle = std::partition(indices.begin() + first, indices.begin() + first + count, [&](uint32_t primitive) {
+            return bin_of(primitive, best_axis) < best_split;
+        });
+
+        auto left_count = static_cast<uint32_t>(middle - indices.begin()) - first;
+        auto left_index = static_cast<uint32_t>(m_nodes.size());
+
+        m_nodes.push_back({
+            .left_first = first,
+            .primitive_count = left_count,
+        });
+
+        m_nodes.push_back({
+            .left_first = first + left_count,
+            .primitive_count = count - left_count,
+        });
+
+        m_nodes[task.node].left_first = left_index;
+        m_nodes[task.node].primitive_count = 0;
+
+        stack.push_back({left_index, task.depth + 1});
+        stack.push_back({left_index + 1, task.depth + 1});
+    }
+
+    std::vector<BVHPrimitive> ordered(primitive_count);
+    for (uint32_t i = 0; i < primitive_count; i++) {
+        ordered[i] = m_primitives[indices[i]];
+    }
+
+    m_primitives = move(ordered);
+
+    debug("BVH: {} primitives, {} nodes", primitive_count, m_nodes.size());
+}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Demo/Math.h>
+
+#include <vector>
+
+namespace Demo {
+class Mesh;
+
+// Layouts of the structs below must match std430 structs in Shaders/bvh.glsl
+
+struct BVHNode {
+    Vector3 min;
+    uint32_t left_first; // Left child for inner nodes, first primitive for leaves
+    Vector3 max;
+    uint32_t primitive_count; // Zero for inner nodes
+};
+
+enum class PrimitiveType : uint32_t {
+    Triangle,
+    Box,
+};
+
+struct BVHPrimitive {
+    Vector3 a; // Triangle: first vertex, box: center
+    PrimitiveType type;
+    Vector3 b; // Triangle: second vertex, box: radius
+    float padding0;
+    Vector3 c; // Triangle: third vertex
+    float padding1;
+    Vector3 albedo;
+    float padding2;
+};
+
+static_assert(sizeof(BVHNode) == 32);
+static_assert(sizeof(BVHPrimitive) == 64);
+
+// Bounding volume hierarchy built with binned surface area heuristic
+class BVH {
+public:
+    BVH() = default;
+
+    void add_triangle(Vector3 a, Vector3 b, Vector3 c, Vector3 albedo);
+    void add_box(Vector3 center, Vector3 radius, Vector3 albedo);
+    void add_mesh(const Mesh& mesh, Vector3 albedo);
+
+    // Reorders primitives so that every leaf references a contiguous range
+    void build();
+
+    const std::vector<BVHNode>& nodes() const { return m_nodes; }
+    const std::vector<BVHPrimitive>& primitives() const { return m_primitives; }
+
+private:
+    std::vector<BVHNode> m_nodes;
+    std::vector<BVHPrimitive> m_primitives;
+};
+}
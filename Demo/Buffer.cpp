@@ -1,22 +1,40 @@
 #include <Demo/Buffer.h>
 
+#include <cstring>
+
 namespace Demo {
-Buffer::Buffer(VmaAllocator allocator, size_t size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage)
+Buffer::Buffer(
+    VmaAllocator allocator,
+    size_t size,
+    VkBufferUsageFlags buffer_usage,
+    VmaMemoryUsage memory_usage,
+    BufferFlags flags,
+    const std::vector<uint32_t>& queue_families)
 {
     m_allocator = allocator;
+    m_size = size;
+
+    bool concurrent = queue_families.size() > 1;
 
     VkBufferCreateInfo buffer_create_info = {
         .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
         .size = size,
         .usage = buffer_usage,
+        .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = concurrent ? static_cast<uint32_t>(queue_families.size()) : 0,
+        .pQueueFamilyIndices = concurrent ? queue_families.data() : nullptr,
     };
 
     VmaAllocationCreateInfo allocation_create_info = {
+        .flags = has_flags(flags, BufferFlags::Mapped) ? VMA_ALLOCATION_CREATE_MAPPED_BIT : 0u,
         .usage = memory_usage,
     };
 
-    auto result = vmaCreateBuffer(allocator, &buffer_create_info, &allocation_create_info, &m_buffer, &m_allocation, nullptr);
+    VmaAllocationInfo allocation_info = {};
+    auto result = vmaCreateBuffer(allocator, &buffer_create_info, &allocation_create_info, &m_buffer, &m_allocation, &allocation_info);
     VK_ASSERT(result);
+
+    m_mapped = allocation_info.pMappedData;
 }
 
 Buffer::~Buffer()
@@ -25,4 +43,33 @@ Buffer::~Buffer()
         vmaDestroyBuffer(m_allocator, m_buffer, m_allocation);
     }
 }
+
+void Buffer::write(const void* data, size_t size, size_t offset)
+{
+    ASSERT(offset + size <= m_size, "Write is out of buffer bounds");
+
+    if (m_mapped) {
+        memcpy(static_cast<uint8_t*>(m_mapped) + offset, data, size);
+        flush(offset, size);
+    } else {
+        map([&](void* ptr) {
+            memcpy(static_cast<uint8_t*>(ptr) + offset, data, size);
+        });
+    }
+}
+
+void Buffer::invalidate()
+{
+    // Memory must stay mapped between invalidation and host reads
+    ASSERT(m_mapped != nullptr, "Only persistently mapped buffers can be invalidated");
+
+    // No-op for host coherent memory
+    vmaInvalidateAllocation(m_allocator, m_allocation, 0, VK_WHOLE_SIZE);
+}
+
+void Buffer::flush(size_t offset, size_t size)
+{
+    // No-op for host coherent memory
+    vmaFlushAllocation(m_allocator, m_allocation, offset, size);
+}
 }
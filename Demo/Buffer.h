@@ -1,28 +1,68 @@
 #pragma once
 
+#include <Demo/Common/Bitflags.h>
 #include <Demo/RendererBase.h>
 #include <vk_mem_alloc.h>
 
+#include <vector>
+
 namespace Demo {
+enum class BufferFlags : uint32_t {
+    None = 0,
+
+    // Memory stays mapped for the whole lifetime of the buffer, which turns
+    // host writes into a plain memcpy. Memory usage must be host visible
+    Mapped = 1 << 0,
+};
+
+DM_BITFLAGS(BufferFlags);
+
 class Buffer : NonCopyable {
 public:
     Buffer() = default;
-    Buffer(VmaAllocator allocator, size_t size, VkBufferUsageFlags buffer_usage, VmaMemoryUsage memory_usage);
+
+    // Buffer is shared concurrently when it's accessed from more than one queue family
+    Buffer(
+        VmaAllocator allocator,
+        size_t size,
+        VkBufferUsageFlags buffer_usage,
+        VmaMemoryUsage memory_usage,
+        BufferFlags flags = BufferFlags::None,
+        const std::vector<uint32_t>& queue_families = {});
     ~Buffer();
 
     VkBuffer raw() const { return m_buffer; }
     const VkBuffer* as_ptr() const { return &m_buffer; }
+    size_t size() const { return m_size; }
+
+    // Null unless the buffer was created with BufferFlags::Mapped
+    void* mapped_data() const { return m_mapped; }
 
     template<typename F>
     void map(F f)
     {
-        void* data = nullptr;
+        if (m_mapped) {
+            f(m_mapped);
+            flush(0, VK_WHOLE_SIZE);
+        } else {
+            void* data = nullptr;
 
-        vmaMapMemory(m_allocator, m_allocation, &data);
-        f(data);
-        vmaUnmapMemory(m_allocator, m_allocation);
+            vmaMapMemory(m_allocator, m_allocation, &data);
+            f(data);
+            flush(0, VK_WHOLE_SIZE);
+            vmaUnmapMemory(m_allocator, m_allocation);
+        }
     }
 
+    // Copies data and flushes only the written range
+    void write(const void* data, size_t size, size_t offset = 0);
+
+    // Makes host writes through mapped_data() visible to the device on non-coherent memory
+    void flush(size_t offset, size_t size);
+
+    // Makes device writes visible to mapped_data() on non-coherent memory
+    void invalidate();
+
     Buffer(Buffer&& other) noexcept
     {
         *this = move(other);
@@ -33,6 +73,8 @@ public:
         swap(m_allocator, other.m_allocator);
         swap(m_buffer, other.m_buffer);
         swap(m_allocation, other.m_allocation);
+        swap(m_size, other.m_size);
+        swap(m_mapped, other.m_mapped);
 
         return *this;
     }
@@ -41,6 +83,8 @@ private:
     VmaAllocator m_allocator = VK_NULL_HANDLE;
     VkBuffer m_buffer = VK_NULL_HANDLE;
     VmaAllocation m_allocation = VK_NULL_HANDLE;
+    size_t m_size = 0;
+    void* m_mapped = nullptr;
 };
 
 }
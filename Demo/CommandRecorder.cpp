@@ -0,0 +1,115 @@
+#include <Demo/CommandRecorder.h>
+#include <Demo/Config.h>
+
+namespace Demo {
+static VkCommandPool create_command_pool(VkDevice device, uint32_t queue_family, VkCommandPoolCreateFlags flags)
+{
+    VkCommandPoolCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = flags,
+        .queueFamilyIndex = queue_family,
+    };
+
+    VkCommandPool pool = VK_NULL_HANDLE;
+    VK_ASSERT(vkCreateCommandPool(device, &create_info, nullptr, &pool));
+
+    return pool;
+}
+
+CommandRecorder::CommandRecorder(VkDevice device, uint32_t queue_family)
+{
+    m_device = device;
+    m_thread_count = thread_count();
+    m_pools.resize(FRAMES_IN_FLIGHT * m_thread_count);
+
+    for (auto& pool : m_pools) {
+        pool.pool = create_command_pool(m_device, queue_family, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    }
+
+    // Reusable command buffers are reset one by one when they are recorded again
+    m_reusable_pool = create_command_pool(m_device, queue_family, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+}
+
+CommandRecorder::~CommandRecorder()
+{
+    if (m_device) {
+        vkDestroyCommandPool(m_device, m_reusable_pool, nullptr);
+
+        for (auto& pool : m_pools) {
+            vkDestroyCommandPool(m_device, pool.pool, nullptr);
+        }
+    }
+}
+
+void CommandRecorder::begin_frame(uint32_t frame_index)
+{
+    m_frame_index = frame_index;
+
+    // Resetting the pool resets all of its command buffers at once, they stay allocated
+    for (uint32_t thread = 0; thread < m_thread_count; thread++) {
+        auto& pool = m_pools[frame_index * m_thread_count + thread];
+        if (pool.primary.used + pool.secondary.used == 0) {
+            continue;
+        }
+
+        VK_ASSERT(vkResetCommandPool(m_device, pool.pool, 0));
+        pool.primary.used = 0;
+        pool.secondary.used = 0;
+    }
+}
+
+VkCommandBuffer CommandRecorder::allocate(VkCommandBufferLevel level)
+{
+    // Only the calling thread touches its pool, so recording on different threads needs no lock
+    auto& pool = m_pools[m_frame_index * m_thread_count + thread_index()];
+    auto& buffers = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? pool.primary : pool.secondary;
+
+    if (buffers.used < buffers.command_buffers.size()) {
+        return buffers.command_buffers[buffers.used++];
+    }
+
+    VkCommandBufferAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = pool.pool,
+        .level = level,
+        .commandBufferCount = 1,
+    };
+
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VK_ASSERT(vkAllocateCommandBuffers(m_device, &allocate_info, &cmd));
+    buffers.command_buffers.push_back(cmd);
+    buffers.used++;
+
+    return cmd;
+}
+
+VkCommandBuffer CommandRecorder::allocate_reusable()
+{
+    VkCommandBufferAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = m_reusable_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+        .commandBufferCount = 1,
+    };
+
+    VkCommandBuffer cmd = VK_NULL_HANDLE;
+    VK_ASSERT(vkAllocateCommandBuffers(m_device, &allocate_info, &cmd));
+
+    return cmd;
+}
+
+void CommandRecorder::begin(VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo* inheritance, VkCommandBufferUsageFlags flags)
+{
+    if (inheritance) {
+        flags |= VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    }
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = flags,
+        .pInheritanceInfo = inheritance,
+    };
+
+    VK_ASSERT(vkBeginCommandBuffer(cmd, &begin_info));
+}
+}
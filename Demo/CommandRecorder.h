@@ -0,0 +1,105 @@
+#pragma once
+
+#include <Demo/Common/Jobs.h>
+#include <Demo/RendererBase.h>
+
+#include <vector>
+
+namespace Demo {
+// Command pools must not be used by two threads at once, so every thread of the job
+// system gets its own pool per frame in flight. Command buffers are allocated once and
+// recycled by resetting their pool when the frame slot they were recorded in comes around again
+class CommandRecorder : NonCopyable {
+public:
+    CommandRecorder() = default;
+    CommandRecorder(VkDevice device, uint32_t queue_family);
+    ~CommandRecorder();
+
+    // Fence of the frame must have been waited for, command buffers it recorded are reset
+    void begin_frame(uint32_t frame_index);
+
+    // Primary command buffer recorded on the calling thread
+    template<typename F>
+    VkCommandBuffer record(F f)
+    {
+        auto cmd = allocate(VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+        begin(cmd, nullptr, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        f(cmd);
+        VK_ASSERT(vkEndCommandBuffer(cmd));
+
+        return cmd;
+    }
+
+    // Records f(cmd, i) for every i in [0, count) into a secondary command buffer of its own,
+    // spread over the job system. Buffers are returned in index order
+    template<typename F>
+    std::vector<VkCommandBuffer> record_secondary(uint32_t count, const VkCommandBufferInheritanceInfo& inheritance, const F& f)
+    {
+        std::vector<VkCommandBuffer> commands(count);
+
+        parallel_for(count, [&](uint32_t i) {
+            auto cmd = allocate(VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+            begin(cmd, &inheritance, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+            f(cmd, i);
+            VK_ASSERT(vkEndCommandBuffer(cmd));
+
+            commands[i] = cmd;
+        });
+
+        return commands;
+    }
+
+    // Secondary command buffer that survives frame resets, for commands that are recorded
+    // once and replayed. Only the thread that calls begin_frame() may use these
+    VkCommandBuffer allocate_reusable();
+
+    // Command buffer must not be pending on the GPU, it's reset before recording
+    template<typename F>
+    void record_reusable(VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo& inheritance, F f)
+    {
+        begin(cmd, &inheritance, 0);
+        f(cmd);
+        VK_ASSERT(vkEndCommandBuffer(cmd));
+    }
+
+    CommandRecorder(CommandRecorder&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    CommandRecorder& operator=(CommandRecorder&& other) noexcept
+    {
+        swap(m_device, other.m_device);
+        swap(m_pools, other.m_pools);
+        swap(m_reusable_pool, other.m_reusable_pool);
+        swap(m_thread_count, other.m_thread_count);
+        swap(m_frame_index, other.m_frame_index);
+
+        return *this;
+    }
+
+private:
+    // Buffers past the used count were recorded in an earlier frame and are free again
+    struct CommandBuffers {
+        std::vector<VkCommandBuffer> command_buffers = {};
+        uint32_t used = 0;
+    };
+
+    struct ThreadPool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        CommandBuffers primary = {};
+        CommandBuffers secondary = {};
+    };
+
+    VkCommandBuffer allocate(VkCommandBufferLevel level);
+    void begin(VkCommandBuffer cmd, const VkCommandBufferInheritanceInfo* inheritance, VkCommandBufferUsageFlags flags);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+
+    // Indexed by frame index * thread count + thread index
+    std::vector<ThreadPool> m_pools = {};
+    VkCommandPool m_reusable_pool = VK_NULL_HANDLE;
+    uint32_t m_thread_count = 0;
+    uint32_t m_frame_index = 0;
+};
+}
@@ -0,0 +1,38 @@
+#include <Demo/Common/AtomicFile.h>
+#include <Demo/Common/Log.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <system_error>
+
+namespace Demo {
+bool write_file_atomically(const std::string& path, std::initializer_list<std::span<const uint8_t>> chunks)
+{
+    // Unique name keeps processes which save at the same time from clobbering each other
+    auto temporary_path = path + "." + std::to_string(std::random_device()()) + ".tmp";
+
+    {
+        std::ofstream ofs(temporary_path, std::ios::binary | std::ios::trunc);
+        for (auto chunk : chunks) {
+            ofs.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+        }
+
+        if (!ofs.good()) {
+            warning("Failed to write {}", temporary_path);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, path, error);
+
+    if (error) {
+        warning("Failed to replace {}: {}", path, error.message());
+        std::filesystem::remove(temporary_path, error);
+        return false;
+    }
+
+    return true;
+}
+}
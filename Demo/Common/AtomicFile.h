@@ -0,0 +1,13 @@
+#pragma once
+
+#include <Demo/Common/Types.h>
+
+#include <initializer_list>
+#include <span>
+#include <string>
+
+namespace Demo {
+// Writes the chunks one after another into a temporary file which then replaces path,
+// so readers never see a partially written file. False and a warning on failure
+bool write_file_atomically(const std::string& path, std::initializer_list<std::span<const uint8_t>> chunks);
+}
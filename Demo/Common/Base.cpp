@@ -4,16 +4,31 @@
 #endif
 
 #include <Demo/Common/Base.h>
+#include <Demo/Common/Log.h>
+#include <csignal>
 #include <cstdio>
 #include <cstdlib>
 
 namespace Demo::Impl {
+static void debug_break()
+{
+#if defined(_MSC_VER)
+    __debugbreak();
+#elif defined(__clang__)
+    __builtin_debugtrap();
+#elif defined(SIGTRAP)
+    raise(SIGTRAP);
+#else
+    abort();
+#endif
+}
+
 [[noreturn]] static void _break()
 {
 #ifdef NDEBUG
     exit(1);
 #else
-    __debugbreak();
+    debug_break();
 
     // This effectively silences noreturn warning. Actual exiting is performed
     // by intrinsic above, but it isn't marked as [[noreturn]] for some reason
@@ -24,6 +39,8 @@ namespace Demo::Impl {
 void assert_handler(bool condition, const char* condition_text, const char* file, size_t line, const char* message)
 {
     if (!condition) {
+        // Queued messages usually explain what led here
+        flush_log();
         fprintf(stderr, "Assertion failed: %s\n", message);
         fprintf(stderr, "%s:%llu: %s\n", file, line, condition_text);
         _break();
@@ -32,12 +49,14 @@ void assert_handler(bool condition, const char* condition_text, const char* file
 
 [[noreturn]] void unreachable_handler(const char* file, size_t line)
 {
+    flush_log();
     fprintf(stderr, "%s:%llu: Execution reached supposedly unreachable point\n", file, line);
     _break();
 }
 
 [[noreturn]] void panic_handler(const char* file, size_t line, const char* message)
 {
+    flush_log();
     fprintf(stderr, "panic:\n");
     fprintf(stderr, "%s:%llu: %s\n", file, line, message);
     _break();
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <Demo/Common/Types.h>
+
 namespace Demo {
 namespace Impl {
 void assert_handler(bool condition, const char* condition_text, const char* file, size_t line, const char* message = "");
@@ -0,0 +1,325 @@
+#include <Demo/Common/Jobs.h>
+#include <Demo/Common/Trace.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Demo {
+// Jobs a thread may have queued at once, submitting more runs them right away
+constexpr int64_t JOB_DEQUE_SIZE = 4096;
+
+// Threads that ever submitted a job, workers included
+constexpr uint32_t MAX_JOB_THREADS = 256;
+
+// Failed steal rounds before an idle worker goes to sleep
+constexpr uint32_t JOB_SPIN_COUNT = 64;
+
+// Workers count from 1, so zero is left for threads the scheduler doesn't own
+static thread_local uint32_t s_thread_index = 0;
+
+// Chase-Lev deque: the owning thread pushes and pops at the bottom, others steal from
+// the top. Only the last job left makes the owner race with thieves
+class JobDeque {
+public:
+    bool push(Job* job)
+    {
+        auto bottom = m_bottom.load(std::memory_order_relaxed);
+        auto top = m_top.load(std::memory_order_acquire);
+
+        if (bottom - top >= JOB_DEQUE_SIZE) {
+            return false;
+        }
+
+        // Release on the slot too publishes what the submitter wrote into the job
+        m_slots[bottom % JOB_DEQUE_SIZE].store(job, std::memory_order_release);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_bottom.store(bottom + 1, std::memory_order_relaxed);
+
+        return true;
+    }
+
+    Job* pop()
+    {
+        auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+        m_bottom.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto top = m_top.load(std::memory_order_relaxed);
+
+        if (top > bottom) {
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        auto* job = m_slots[bottom % JOB_DEQUE_SIZE].load(std::memory_order_acquire);
+        if (top == bottom) {
+            if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+                job = nullptr;
+            }
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    Job* steal()
+    {
+        auto top = m_top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto bottom = m_bottom.load(std::memory_order_acquire);
+
+        if (top >= bottom) {
+            return nullptr;
+        }
+
+        auto* job = m_slots[top % JOB_DEQUE_SIZE].load(std::memory_order_acquire);
+        if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return nullptr;
+        }
+
+        return job;
+    }
+
+private:
+    // Thieves read and the owner writes the same counters, so they get their own cache lines
+    alignas(64) std::atomic<int64_t> m_top = 0;
+    alignas(64) std::atomic<int64_t> m_bottom = 0;
+    std::unique_ptr<std::atomic<Job*>[]> m_slots = std::make_unique<std::atomic<Job*>[]>(JOB_DEQUE_SIZE);
+};
+
+class JobScheduler : NonCopyable {
+public:
+    JobScheduler()
+    {
+        // The thread that waits for a job group runs jobs too, so one core is left for it
+        auto worker_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+        for (uint32_t i = 0; i < worker_count; i++) {
+            m_workers.emplace_back([this, i] {
+                s_thread_index = i + 1;
+                work();
+            });
+        }
+    }
+
+    ~JobScheduler()
+    {
+        m_stopping.store(true);
+        m_epoch.fetch_add(1);
+        m_epoch.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+
+        // Deques are left alive, threads still holding one may keep running jobs inline
+    }
+
+    uint32_t thread_count() const { return static_cast<uint32_t>(m_workers.size()) + 1; }
+
+    void submit(Job& job)
+    {
+        job.counter->m_pending.fetch_add(1, std::memory_order_relaxed);
+
+        auto* deque = thread_deque();
+        if (!deque || !deque->push(&job)) {
+            run(&job);
+            return;
+        }
+
+        // Sleeping workers register before checking the deques one last time, so either
+        // they find this job or they are seen here
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed) > 0) {
+            m_epoch.fetch_add(1, std::memory_order_relaxed);
+            m_epoch.notify_one();
+        }
+    }
+
+    void wait(const JobCounter& counter)
+    {
+        while (!counter.done()) {
+            if (auto* job = find_job()) {
+                run(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    static void run(Job* job)
+    {
+        // Waiter may free the job as soon as the counter drops, so it's read first
+        auto* counter = job->counter;
+        job->execute(*job);
+        counter->m_pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    JobDeque* thread_deque()
+    {
+        // Registration locks once per thread, deques are never freed so thieves can
+        // keep scanning them after their thread exited
+        thread_local JobDeque* deque = [this]() -> JobDeque* {
+            std::lock_guard lock(m_mutex);
+
+            auto index = m_deque_count.load(std::memory_order_relaxed);
+            if (index == MAX_JOB_THREADS) {
+                return nullptr;
+            }
+
+            auto* deque = new JobDeque();
+            m_deques[index].store(deque, std::memory_order_relaxed);
+            m_deque_count.store(index + 1, std::memory_order_release);
+            return deque;
+        }();
+
+        return deque;
+    }
+
+    Job* find_job()
+    {
+        auto* own = thread_deque();
+        if (own) {
+            if (auto* job = own->pop()) {
+                return job;
+            }
+        }
+
+        // Starting at a different deque per attempt spreads thieves over victims
+        thread_local uint32_t victim = 0;
+        auto count = m_deque_count.load(std::memory_order_acquire);
+
+        for (uint32_t i = 0; i < count; i++) {
+            auto* deque = m_deques[(victim + i) % count].load(std::memory_order_relaxed);
+            if (deque == own) {
+                continue;
+            }
+
+            if (auto* job = deque->steal()) {
+                victim = (victim + i) % count;
+                return job;
+            }
+        }
+
+        victim++;
+        return nullptr;
+    }
+
+    void work()
+    {
+        trace_thread_name("Worker");
+
+        uint32_t idle = 0;
+        while (!m_stopping.load(std::memory_order_relaxed)) {
+            if (auto* job = find_job()) {
+                run(job);
+                idle = 0;
+                continue;
+            }
+
+            if (++idle < JOB_SPIN_COUNT) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            auto epoch = m_epoch.load();
+            m_sleeping.fetch_add(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (auto* job = find_job()) {
+                m_sleeping.fetch_sub(1);
+                run(job);
+                idle = 0;
+                continue;
+            }
+
+            if (!m_stopping.load()) {
+                m_epoch.wait(epoch);
+            }
+            m_sleeping.fetch_sub(1);
+        }
+    }
+
+    std::mutex m_mutex;
+    std::atomic<JobDeque*> m_deques[MAX_JOB_THREADS] = {};
+    std::atomic<uint32_t> m_deque_count = 0;
+
+    std::atomic<uint32_t> m_epoch = 0;
+    std::atomic<uint32_t> m_sleeping = 0;
+    std::atomic<bool> m_stopping = false;
+    std::vector<std::thread> m_workers;
+};
+
+static JobScheduler& scheduler()
+{
+    static JobScheduler scheduler;
+    return scheduler;
+}
+
+uint32_t thread_count()
+{
+    return scheduler().thread_count();
+}
+
+uint32_t thread_index()
+{
+    return s_thread_index;
+}
+
+void submit(Job& job)
+{
+    scheduler().submit(job);
+}
+
+void wait(const JobCounter& counter)
+{
+    scheduler().wait(counter);
+}
+
+namespace Impl {
+struct ParallelForJob : Job {
+    void (*task)(const void* context, uint32_t index) = nullptr;
+    const void* context = nullptr;
+    std::atomic<uint32_t>* next = nullptr;
+    uint32_t count = 0;
+};
+
+static void run_parallel_for(Job& job)
+{
+    auto& range = static_cast<ParallelForJob&>(job);
+    for (uint32_t i = range.next->fetch_add(1); i < range.count; i = range.next->fetch_add(1)) {
+        range.task(range.context, i);
+    }
+}
+
+void parallel_for(uint32_t count, void (*task)(const void* context, uint32_t index), const void* context)
+{
+    if (count == 0) {
+        return;
+    }
+
+    // Items are claimed one at a time, so a job that started late just finds less work
+    std::atomic<uint32_t> next = 0;
+    JobCounter counter;
+
+    ParallelForJob caller_job;
+    caller_job.execute = run_parallel_for;
+    caller_job.counter = &counter;
+    caller_job.task = task;
+    caller_job.context = context;
+    caller_job.next = &next;
+    caller_job.count = count;
+
+    std::vector<ParallelForJob> helpers(std::min(count, thread_count()) - 1, caller_job);
+    for (auto& helper : helpers) {
+        submit(helper);
+    }
+
+    run_parallel_for(caller_job);
+    wait(counter);
+}
+}
+}
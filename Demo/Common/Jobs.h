@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Demo/Common/Types.h>
+
+#include <atomic>
+
+namespace Demo {
+class JobCounter;
+
+// Jobs are owned by whoever submits them and must stay alive until their counter reaches zero
+struct Job {
+    void (*execute)(Job& job) = nullptr;
+    JobCounter* counter = nullptr;
+};
+
+// Number of jobs of a group that haven't finished yet
+class JobCounter : NonCopyable {
+public:
+    bool done() const { return m_pending.load(std::memory_order_acquire) == 0; }
+
+private:
+    friend class JobScheduler;
+
+    std::atomic<uint32_t> m_pending = 0;
+};
+
+// Worker threads plus the calling thread
+uint32_t thread_count();
+
+// Index of the calling thread in [0, thread_count()), threads outside the pool share index 0
+uint32_t thread_index();
+
+// Pushes the job to the deque of the calling thread, idle workers steal it from there
+void submit(Job& job);
+
+// Runs other jobs until the counter reaches zero, so waiting inside a job never deadlocks
+void wait(const JobCounter& counter);
+
+namespace Impl {
+void parallel_for(uint32_t count, void (*task)(const void* context, uint32_t index), const void* context);
+}
+
+// Runs task(i) for every i in [0, count), with the calling thread taking part
+template<typename F>
+void parallel_for(uint32_t count, const F& task)
+{
+    Impl::parallel_for(count, [](const void* context, uint32_t index) { (*static_cast<const F*>(context))(index); }, &task);
+}
+}
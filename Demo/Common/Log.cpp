@@ -1,5 +1,16 @@
 #include <Demo/Common/Log.h>
 
+#include <fmt/format.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
 #define DM_COLORED_OUTPUT 0
 
 #if DM_COLORED_OUTPUT
@@ -15,26 +26,264 @@
 #endif
 
 namespace Demo::Impl {
-void log(LogLevel level, const char* format, const fmt::format_args& args)
-{
-    auto text = fmt::vformat(format, args);
-    const char* level_text = "";
+// Messages in flight, producers drop messages rather than wait when it's full
+constexpr uint64_t LOG_QUEUE_SIZE = 4096;
+
+// Identical messages logged by a thread more often than this per window are suppressed
+constexpr uint32_t LOG_RATE_LIMIT = 10;
+constexpr uint64_t LOG_RATE_WINDOW = 1'000'000'000; // 1 second (in nanoseconds)
 
+static const char* level_text(LogLevel level)
+{
     switch (level) {
     case LogLevel::Debug:
-        level_text = "DEBUG";
-        break;
+        return "DEBUG";
     case LogLevel::Info:
-        level_text = DM_GREEN " INFO" DM_RESET;
-        break;
+        return DM_GREEN " INFO" DM_RESET;
     case LogLevel::Warning:
-        level_text = DM_YELLOW " WARN" DM_RESET;
-        break;
+        return DM_YELLOW " WARN" DM_RESET;
     case LogLevel::Error:
-        level_text = DM_RED "ERROR" DM_RESET;
-        break;
+        return DM_RED "ERROR" DM_RESET;
+    }
+
+    return "";
+}
+
+static void write_message(LogLevel level, std::string_view text)
+{
+    fmt::print("{}: {}\n", level_text(level), text);
+}
+
+// Bounded multiple producer, single consumer queue after Dmitry Vyukov. A slot's sequence
+// tells whose turn it is, so producers only contend on the enqueue position
+class LogQueue {
+public:
+    LogQueue()
+        : m_slots(std::make_unique<Slot[]>(LOG_QUEUE_SIZE))
+    {
+        for (uint64_t i = 0; i < LOG_QUEUE_SIZE; i++) {
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        m_writer = std::thread([this] { drain(); });
+    }
+
+    ~LogQueue()
+    {
+        m_stopping.store(true);
+        wake();
+        m_writer.join();
+    }
+
+    bool push(LogLevel level, std::string_view text)
+    {
+        auto position = m_enqueue_position.load(std::memory_order_relaxed);
+        Slot* slot = nullptr;
+
+        while (true) {
+            slot = &m_slots[position % LOG_QUEUE_SIZE];
+            auto sequence = slot->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<int64_t>(sequence - position);
+
+            if (difference == 0) {
+                if (m_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (difference < 0) {
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                position = m_enqueue_position.load(std::memory_order_relaxed);
+            }
+        }
+
+        // Slot strings keep their capacity, so steady state logging doesn't allocate
+        slot->level = level;
+        slot->text.assign(text);
+        slot->sequence.store(position + 1, std::memory_order_release);
+
+        // Only pays for a wake up when the writer ran out of work and went to sleep
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_sleeping.load(std::memory_order_relaxed)) {
+            wake();
+        }
+
+        return true;
+    }
+
+    void flush()
+    {
+        auto target = m_enqueue_position.load();
+        wake();
+
+        while (m_written.load(std::memory_order_acquire) < target) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> sequence = 0;
+        LogLevel level = LogLevel::Debug;
+        std::string text;
+    };
+
+    void wake()
+    {
+        if (m_sleeping.exchange(false)) {
+            m_sleeping.notify_one();
+        }
+    }
+
+    bool pop(LogLevel& level, std::string& text)
+    {
+        auto& slot = m_slots[m_dequeue_position % LOG_QUEUE_SIZE];
+        if (slot.sequence.load(std::memory_order_acquire) != m_dequeue_position + 1) {
+            return false;
+        }
+
+        level = slot.level;
+        text.swap(slot.text);
+        slot.sequence.store(m_dequeue_position + LOG_QUEUE_SIZE, std::memory_order_release);
+        m_dequeue_position++;
+
+        return true;
+    }
+
+    void drain()
+    {
+        LogLevel level = LogLevel::Debug;
+        std::string text;
+
+        while (true) {
+            while (pop(level, text)) {
+                write_message(level, text);
+                m_written.store(m_dequeue_position, std::memory_order_release);
+            }
+
+            if (auto dropped = m_dropped.exchange(0, std::memory_order_relaxed)) {
+                write_message(LogLevel::Warning, fmt::format("Log queue was full, {} messages were dropped", dropped));
+            }
+
+            fflush(stdout);
+
+            if (m_stopping.load()) {
+                break;
+            }
+
+            // Producers check the flag after publishing, so one of both sides sees the other
+            m_sleeping.store(true);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (m_slots[m_dequeue_position % LOG_QUEUE_SIZE].sequence.load(std::memory_order_acquire) == m_dequeue_position + 1 || m_stopping.load()) {
+                m_sleeping.store(false);
+                continue;
+            }
+
+            m_sleeping.wait(true);
+        }
+    }
+
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_enqueue_position = 0;
+    uint64_t m_dequeue_position = 0;
+    std::atomic<uint64_t> m_written = 0;
+    std::atomic<uint64_t> m_dropped = 0;
+
+    std::atomic<bool> m_sleeping = false;
+    std::atomic<bool> m_stopping = false;
+    std::thread m_writer;
+};
+
+// Messages logged while static objects are destroyed are written synchronously
+static std::atomic<bool> s_queue_destroyed = false;
+
+struct LogQueueOwner {
+    LogQueue queue;
+
+    ~LogQueueOwner()
+    {
+        s_queue_destroyed.store(true);
+    }
+};
+
+static LogQueue* log_queue()
+{
+    if (s_queue_destroyed.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+
+    static LogQueueOwner owner;
+    return &owner.queue;
+}
+
+struct RateLimit {
+    uint64_t window_begin = 0;
+    uint32_t count = 0;
+    uint32_t suppressed = 0;
+};
+
+static uint64_t hash_text(std::string_view text)
+{
+    uint64_t hash = 0xCBF29CE484222325;
+    for (char c : text) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001B3;
+    }
+
+    return hash;
+}
+
+static uint64_t now()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void log(LogLevel level, const char* format, const fmt::format_args& args)
+{
+    // Formatting reuses the thread's buffer, so it doesn't allocate once it has grown
+    thread_local fmt::memory_buffer buffer;
+    thread_local std::unordered_map<uint64_t, RateLimit> rate_limits;
+
+    buffer.clear();
+    fmt::vformat_to(fmt::appender(buffer), format, args);
+    std::string_view text(buffer.data(), buffer.size());
+
+    // Validation layers may repeat the same warning thousands of times per frame
+    auto& rate_limit = rate_limits[hash_text(text)];
+    auto time = now();
+
+    if (time - rate_limit.window_begin > LOG_RATE_WINDOW) {
+        if (rate_limit.suppressed > 0) {
+            fmt::format_to(fmt::appender(buffer), " ({} identical messages suppressed)", rate_limit.suppressed);
+            text = {buffer.data(), buffer.size()};
+        }
+
+        rate_limit = {.window_begin = time};
     }
 
-    fmt::print("{}: {}\n", level_text, text);
+    if (++rate_limit.count > LOG_RATE_LIMIT) {
+        rate_limit.suppressed++;
+        return;
+    }
+
+    // Forgetting counters only lets a few more repeats through
+    if (rate_limits.size() > LOG_QUEUE_SIZE) {
+        rate_limits.clear();
+    }
+
+    if (auto* queue = log_queue()) {
+        queue->push(level, text);
+    } else {
+        write_message(level, text);
+    }
+}
+}
+
+namespace Demo {
+void flush_log()
+{
+    if (auto* queue = Impl::log_queue()) {
+        queue->flush();
+    }
 }
 }
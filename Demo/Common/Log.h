@@ -2,6 +2,11 @@
 
 #include <fmt/core.h>
 
+// Messages below this level compile to nothing: 0 debug, 1 info, 2 warning, 3 error
+#ifndef DM_LOG_LEVEL
+#define DM_LOG_LEVEL 0
+#endif
+
 namespace Demo {
 enum class LogLevel {
     Debug,
@@ -10,13 +15,23 @@ enum class LogLevel {
     Error,
 };
 
+constexpr LogLevel MIN_LOG_LEVEL = static_cast<LogLevel>(DM_LOG_LEVEL);
+
 namespace Impl {
+// Formats on the calling thread and queues the text for a background writer, never blocks
 void log(LogLevel level, const char* format, const fmt::format_args& args);
 }
 
+// Waits until every message queued so far was written out
+void flush_log();
+
 template<typename... Args>
 void log(LogLevel level, const char* format, Args&&... args)
 {
+    if (level < MIN_LOG_LEVEL) {
+        return;
+    }
+
     auto fmt_args = fmt::make_format_args(std::forward<Args>(args)...);
     Demo::Impl::log(level, format, fmt_args);
 }
@@ -24,25 +39,32 @@ void log(LogLevel level, const char* format, Args&&... args)
 template<typename... Args>
 void debug(const char* format, Args&&... args)
 {
-    Demo::log(LogLevel::Debug, format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Debug >= MIN_LOG_LEVEL) {
+        Demo::log(LogLevel::Debug, format, std::forward<Args>(args)...);
+    }
 }
 
 template<typename... Args>
 void info(const char* format, Args&&... args)
 {
-    Demo::log(LogLevel::Info, format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Info >= MIN_LOG_LEVEL) {
+        Demo::log(LogLevel::Info, format, std::forward<Args>(args)...);
+    }
 }
 
 template<typename... Args>
 void warning(const char* format, Args&&... args)
 {
-    Demo::log(LogLevel::Warning, format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Warning >= MIN_LOG_LEVEL) {
+        Demo::log(LogLevel::Warning, format, std::forward<Args>(args)...);
+    }
 }
 
 template<typename... Args>
 void error(const char* format, Args&&... args)
 {
-    Demo::log(LogLevel::Error, format, std::forward<Args>(args)...);
+    if constexpr (LogLevel::Error >= MIN_LOG_LEVEL) {
+        Demo::log(LogLevel::Error, format, std::forward<Args>(args)...);
+    }
 }
 }
-
@@ -0,0 +1,83 @@
+#include <Demo/Common/Base.h>
+#include <Demo/Common/MappedFile.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Demo {
+#ifdef _WIN32
+MappedFile::MappedFile(const char* path)
+{
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    LARGE_INTEGER size = {};
+    GetFileSizeEx(file, &size);
+    m_size = static_cast<size_t>(size.QuadPart);
+    m_open = true;
+
+    // Zero-sized mappings are not allowed
+    if (m_size > 0) {
+        m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        ASSERT(m_mapping != nullptr, "Failed to map file");
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        ASSERT(m_data != nullptr, "Failed to map file");
+    }
+
+    // The mapping keeps the file alive
+    CloseHandle(file);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+}
+#else
+MappedFile::MappedFile(const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info = {};
+    fstat(fd, &info);
+    m_size = static_cast<size_t>(info.st_size);
+    m_open = true;
+
+    // Zero-sized mappings are not allowed
+    if (m_size > 0) {
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ASSERT(data != MAP_FAILED, "Failed to map file");
+        m_data = static_cast<const uint8_t*>(data);
+
+        // Importers walk the file front to back
+        madvise(data, m_size, MADV_SEQUENTIAL);
+    }
+
+    // The mapping keeps the file alive
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (m_data) {
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+    }
+}
+#endif
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <Demo/Common/Base.h>
+#include <Demo/Common/Types.h>
+
+#include <string_view>
+
+namespace Demo {
+// Read-only view of a whole file, pages are loaded by the OS on first access
+class MappedFile : public NonCopyable {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const char* path);
+    ~MappedFile();
+
+    // False if the file couldn't be opened, empty files are still open
+    bool is_open() const { return m_open; }
+    const uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    std::string_view text() const { return {reinterpret_cast<const char*>(m_data), m_size}; }
+
+    MappedFile(MappedFile&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+        swap(m_open, other.m_open);
+        swap(m_data, other.m_data);
+        swap(m_size, other.m_size);
+#ifdef _WIN32
+        swap(m_mapping, other.m_mapping);
+#endif
+
+        return *this;
+    }
+
+private:
+    bool m_open = false;
+    const uint8_t* m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void* m_mapping = nullptr;
+#endif
+};
+}
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <Demo/Common/Types.h>
+
+// SSE2 is part of x86-64, AVX and FMA need DEMO_AVX2 in CMake
+#if defined(__AVX__)
+#define DM_SIMD_AVX 1
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__)
+#define DM_SIMD_SSE 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define DM_SIMD_NEON 1
+#include <arm_neon.h>
+#else
+#define DM_SIMD_SCALAR 1
+#endif
+
+namespace Demo {
+// Four float lanes in the widest register every target has
+struct Float4 {
+#if DM_SIMD_SSE
+    __m128 v;
+#elif DM_SIMD_NEON
+    float32x4_t v;
+#else
+    float v[4];
+#endif
+
+    static Float4 load(const float* data)
+    {
+#if DM_SIMD_SSE
+        return {_mm_loadu_ps(data)};
+#elif DM_SIMD_NEON
+        return {vld1q_f32(data)};
+#else
+        return {{data[0], data[1], data[2], data[3]}};
+#endif
+    }
+
+    static Float4 splat(float value)
+    {
+#if DM_SIMD_SSE
+        return {_mm_set1_ps(value)};
+#elif DM_SIMD_NEON
+        return {vdupq_n_f32(value)};
+#else
+        return {{value, value, value, value}};
+#endif
+    }
+
+    void store(float* data) const
+    {
+#if DM_SIMD_SSE
+        _mm_storeu_ps(data, v);
+#elif DM_SIMD_NEON
+        vst1q_f32(data, v);
+#else
+        for (uint32_t i = 0; i < 4; i++) {
+            data[i] = v[i];
+        }
+#endif
+    }
+
+    float sum() const
+    {
+#if DM_SIMD_SSE
+        __m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        __m128 sums = _mm_add_ps(v, shuffled);
+        shuffled = _mm_movehl_ps(shuffled, sums);
+        return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+#elif DM_SIMD_NEON
+        return vaddvq_f32(v);
+#else
+        return (v[0] + v[1]) + (v[2] + v[3]);
+#endif
+    }
+};
+
+#if DM_SIMD_SSE
+inline Float4 operator+(Float4 lhs, Float4 rhs) { return {_mm_add_ps(lhs.v, rhs.v)}; }
+inline Float4 operator-(Float4 lhs, Float4 rhs) { return {_mm_sub_ps(lhs.v, rhs.v)}; }
+inline Float4 operator*(Float4 lhs, Float4 rhs) { return {_mm_mul_ps(lhs.v, rhs.v)}; }
+inline Float4 operator/(Float4 lhs, Float4 rhs) { return {_mm_div_ps(lhs.v, rhs.v)}; }
+inline Float4 min(Float4 lhs, Float4 rhs) { return {_mm_min_ps(lhs.v, rhs.v)}; }
+inline Float4 max(Float4 lhs, Float4 rhs) { return {_mm_max_ps(lhs.v, rhs.v)}; }
+inline Float4 abs(Float4 value) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), value.v)}; }
+#if defined(__FMA__)
+inline Float4 multiply_add(Float4 a, Float4 b, Float4 c) { return {_mm_fmadd_ps(a.v, b.v, c.v)}; }
+#else
+inline Float4 multiply_add(Float4 a, Float4 b, Float4 c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+#endif
+#elif DM_SIMD_NEON
+inline Float4 operator+(Float4 lhs, Float4 rhs) { return {vaddq_f32(lhs.v, rhs.v)}; }
+inline Float4 operator-(Float4 lhs, Float4 rhs) { return {vsubq_f32(lhs.v, rhs.v)}; }
+inline Float4 operator*(Float4 lhs, Float4 rhs) { return {vmulq_f32(lhs.v, rhs.v)}; }
+inline Float4 operator/(Float4 lhs, Float4 rhs) { return {vdivq_f32(lhs.v, rhs.v)}; }
+inline Float4 min(Float4 lhs, Float4 rhs) { return {vminq_f32(lhs.v, rhs.v)}; }
+inline Float4 max(Float4 lhs, Float4 rhs) { return {vmaxq_f32(lhs.v, rhs.v)}; }
+inline Float4 abs(Float4 value) { return {vabsq_f32(value.v)}; }
+inline Float4 multiply_add(Float4 a, Float4 b, Float4 c) { return {vfmaq_f32(c.v, a.v, b.v)}; }
+#else
+template<typename F>
+inline Float4 per_lane(Float4 lhs, Float4 rhs, F f)
+{
+    return {{f(lhs.v[0], rhs.v[0]), f(lhs.v[1], rhs.v[1]), f(lhs.v[2], rhs.v[2]), f(lhs.v[3], rhs.v[3])}};
+}
+
+inline Float4 operator+(Float4 lhs, Float4 rhs) { return per_lane(lhs, rhs, [](float a, float b) { return a + b; }); }
+inline Float4 operator-(Float4 lhs, Float4 rhs) { return per_lane(lhs, rhs, [](float a, float b) { return a - b; }); }
+inline Float4 operator*(Float4 lhs, Float4 rhs) { return per_lane(lhs, rhs, [](float a, float b) { return a * b; }); }
+inline Float4 operator/(Float4 lhs, Float4 rhs) { return per_lane(lhs, rhs, [](float a, float b) { return a / b; }); }
+inline Float4 min(Float4 lhs, Float4 rhs) { return per_lane(lhs, rhs, [](float a, float b) { return b < a ? b : a; }); }
+inline Float4 max(Float4 lhs, Float4 rhs) { return per_lane(lhs, rhs, [](float a, float b) { return a < b ? b : a; }); }
+inline Float4 abs(Float4 value) { return per_lane(value, value, [](float a, float) { return a < 0.0f ? -a : a; }); }
+inline Float4 multiply_add(Float4 a, Float4 b, Float4 c) { return a * b + c; }
+#endif
+
+// Per-lane result of a Float4 comparison, lanes are all ones or all zeros
+struct Mask4 {
+#if DM_SIMD_SSE
+    __m128 v;
+#elif DM_SIMD_NEON
+    uint32x4_t v;
+#else
+    bool v[4];
+#endif
+};
+
+#if DM_SIMD_SSE
+inline Mask4 operator<(Float4 lhs, Float4 rhs) { return {_mm_cmplt_ps(lhs.v, rhs.v)}; }
+inline Mask4 operator<=(Float4 lhs, Float4 rhs) { return {_mm_cmple_ps(lhs.v, rhs.v)}; }
+inline Mask4 operator>(Float4 lhs, Float4 rhs) { return {_mm_cmpgt_ps(lhs.v, rhs.v)}; }
+inline Mask4 operator>=(Float4 lhs, Float4 rhs) { return {_mm_cmpge_ps(lhs.v, rhs.v)}; }
+inline Mask4 operator!=(Float4 lhs, Float4 rhs) { return {_mm_cmpneq_ps(lhs.v, rhs.v)}; }
+inline Mask4 operator&(Mask4 lhs, Mask4 rhs) { return {_mm_and_ps(lhs.v, rhs.v)}; }
+inline Mask4 operator|(Mask4 lhs, Mask4 rhs) { return {_mm_or_ps(lhs.v, rhs.v)}; }
+inline Mask4 operator!(Mask4 mask) { return {_mm_xor_ps(mask.v, _mm_castsi128_ps(_mm_set1_epi32(-1)))}; }
+inline bool any(Mask4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+inline Float4 select(Mask4 mask, Float4 if_true, Float4 if_false) { return {_mm_or_ps(_mm_and_ps(mask.v, if_true.v), _mm_andnot_ps(mask.v, if_false.v))}; }
+#elif DM_SIMD_NEON
+inline Mask4 operator<(Float4 lhs, Float4 rhs) { return {vcltq_f32(lhs.v, rhs.v)}; }
+inline Mask4 operator<=(Float4 lhs, Float4 rhs) { return {vcleq_f32(lhs.v, rhs.v)}; }
+inline Mask4 operator>(Float4 lhs, Float4 rhs) { return {vcgtq_f32(lhs.v, rhs.v)}; }
+inline Mask4 operator>=(Float4 lhs, Float4 rhs) { return {vcgeq_f32(lhs.v, rhs.v)}; }
+inline Mask4 operator!=(Float4 lhs, Float4 rhs) { return {vmvnq_u32(vceqq_f32(lhs.v, rhs.v))}; }
+inline Mask4 operator&(Mask4 lhs, Mask4 rhs) { return {vandq_u32(lhs.v, rhs.v)}; }
+inline Mask4 operator|(Mask4 lhs, Mask4 rhs) { return {vorrq_u32(lhs.v, rhs.v)}; }
+inline Mask4 operator!(Mask4 mask) { return {vmvnq_u32(mask.v)}; }
+inline bool any(Mask4 mask) { return vmaxvq_u32(mask.v) != 0; }
+inline Float4 select(Mask4 mask, Float4 if_true, Float4 if_false) { return {vbslq_f32(mask.v, if_true.v, if_false.v)}; }
+#else
+template<typename F>
+inline Mask4 compare(Float4 lhs, Float4 rhs, F f)
+{
+    return {{f(lhs.v[0], rhs.v[0]), f(lhs.v[1], rhs.v[1]), f(lhs.v[2], rhs.v[2]), f(lhs.v[3], rhs.v[3])}};
+}
+
+inline Mask4 operator<(Float4 lhs, Float4 rhs) { return compare(lhs, rhs, [](float a, float b) { return a < b; }); }
+inline Mask4 operator<=(Float4 lhs, Float4 rhs) { return compare(lhs, rhs, [](float a, float b) { return a <= b; }); }
+inline Mask4 operator>(Float4 lhs, Float4 rhs) { return compare(lhs, rhs, [](float a, float b) { return a > b; }); }
+inline Mask4 operator>=(Float4 lhs, Float4 rhs) { return compare(lhs, rhs, [](float a, float b) { return a >= b; }); }
+inline Mask4 operator!=(Float4 lhs, Float4 rhs) { return compare(lhs, rhs, [](float a, float b) { return a != b; }); }
+inline Mask4 operator&(Mask4 lhs, Mask4 rhs) { return {{lhs.v[0] && rhs.v[0], lhs.v[1] && rhs.v[1], lhs.v[2] && rhs.v[2], lhs.v[3] && rhs.v[3]}}; }
+inline Mask4 operator|(Mask4 lhs, Mask4 rhs) { return {{lhs.v[0] || rhs.v[0], lhs.v[1] || rhs.v[1], lhs.v[2] || rhs.v[2], lhs.v[3] || rhs.v[3]}}; }
+inline Mask4 operator!(Mask4 mask) { return {{!mask.v[0], !mask.v[1], !mask.v[2], !mask.v[3]}}; }
+inline bool any(Mask4 mask) { return mask.v[0] || mask.v[1] || mask.v[2] || mask.v[3]; }
+
+inline Float4 select(Mask4 mask, Float4 if_true, Float4 if_false)
+{
+    return {{
+        mask.v[0] ? if_true.v[0] : if_false.v[0],
+        mask.v[1] ? if_true.v[1] : if_false.v[1],
+        mask.v[2] ? if_true.v[2] : if_false.v[2],
+        mask.v[3] ? if_true.v[3] : if_false.v[3],
+    }};
+}
+#endif
+
+// Single lane with the same interface, batch kernels use it for leftover elements
+struct Float1 {
+    float v;
+
+    static Float1 load(const float* data) { return {*data}; }
+    static Float1 splat(float value) { return {value}; }
+    void store(float* data) const { *data = v; }
+};
+
+inline Float1 operator+(Float1 lhs, Float1 rhs) { return {lhs.v + rhs.v}; }
+inline Float1 operator-(Float1 lhs, Float1 rhs) { return {lhs.v - rhs.v}; }
+inline Float1 operator*(Float1 lhs, Float1 rhs) { return {lhs.v * rhs.v}; }
+inline Float1 min(Float1 lhs, Float1 rhs) { return {rhs.v < lhs.v ? rhs.v : lhs.v}; }
+inline Float1 max(Float1 lhs, Float1 rhs) { return {lhs.v < rhs.v ? rhs.v : lhs.v}; }
+inline Float1 abs(Float1 value) { return {value.v < 0.0f ? -value.v : value.v}; }
+inline Float1 multiply_add(Float1 a, Float1 b, Float1 c) { return {a.v * b.v + c.v}; }
+
+#if DM_SIMD_AVX
+// Eight float lanes, only used by batch kernels
+struct Float8 {
+    __m256 v;
+
+    static Float8 load(const float* data) { return {_mm256_loadu_ps(data)}; }
+    static Float8 splat(float value) { return {_mm256_set1_ps(value)}; }
+    void store(float* data) const { _mm256_storeu_ps(data, v); }
+};
+
+inline Float8 operator+(Float8 lhs, Float8 rhs) { return {_mm256_add_ps(lhs.v, rhs.v)}; }
+inline Float8 operator-(Float8 lhs, Float8 rhs) { return {_mm256_sub_ps(lhs.v, rhs.v)}; }
+inline Float8 operator*(Float8 lhs, Float8 rhs) { return {_mm256_mul_ps(lhs.v, rhs.v)}; }
+inline Float8 min(Float8 lhs, Float8 rhs) { return {_mm256_min_ps(lhs.v, rhs.v)}; }
+inline Float8 max(Float8 lhs, Float8 rhs) { return {_mm256_max_ps(lhs.v, rhs.v)}; }
+inline Float8 abs(Float8 value) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), value.v)}; }
+#if defined(__FMA__)
+inline Float8 multiply_add(Float8 a, Float8 b, Float8 c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+#else
+inline Float8 multiply_add(Float8 a, Float8 b, Float8 c) { return {_mm256_add_ps(_mm256_mul_ps(a.v, b.v), c.v)}; }
+#endif
+
+// Widest lane type, batch kernels are written once against it
+using FloatN = Float8;
+#else
+using FloatN = Float4;
+#endif
+
+constexpr uint32_t SIMD_WIDTH = sizeof(FloatN) / sizeof(float);
+}
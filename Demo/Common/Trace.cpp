@@ -0,0 +1,183 @@
+#include <Demo/Common/Log.h>
+#include <Demo/Common/Trace.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+namespace Demo {
+// Zones kept per track, a few seconds of a busy thread
+constexpr uint64_t TRACE_RING_SIZE = 1 << 16;
+
+// Slots are atomics so that write_trace() may read them while their thread keeps
+// writing, relaxed stores compile to plain moves
+struct TraceSlot {
+    std::atomic<const char*> name = nullptr;
+    std::atomic<uint64_t> begin = 0;
+    std::atomic<uint64_t> end = 0;
+};
+
+// Single writer ring buffer guarded like a seqlock, begun counts every zone whose slot
+// write has started and head every zone whose slot write has finished
+struct TraceTrack {
+    std::atomic<const char*> name = nullptr;
+    uint32_t id = 0;
+    std::unique_ptr<TraceSlot[]> slots = std::make_unique<TraceSlot[]>(TRACE_RING_SIZE);
+    std::atomic<uint64_t> begun = 0;
+    std::atomic<uint64_t> head = 0;
+
+    void write(const char* zone_name, uint64_t zone_begin, uint64_t zone_end)
+    {
+        auto index = head.load(std::memory_order_relaxed);
+        auto& slot = slots[index % TRACE_RING_SIZE];
+
+        // A reader which sees any of the slot stores below also sees begun
+        begun.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.name.store(zone_name, std::memory_order_relaxed);
+        slot.begin.store(zone_begin, std::memory_order_relaxed);
+        slot.end.store(zone_end, std::memory_order_relaxed);
+
+        head.store(index + 1, std::memory_order_release);
+    }
+};
+
+// Tracks are never freed, so zones of threads that already exited can still be written out
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<TraceTrack*> tracks;
+    TraceTrack gpu = {.name = "GPU", .id = 0};
+};
+
+static TraceRegistry& registry()
+{
+    static TraceRegistry registry;
+    return registry;
+}
+
+static TraceTrack& thread_track()
+{
+    // Registration locks once per thread, every zone after that is lock free
+    thread_local TraceTrack* track = [] {
+        auto& r = registry();
+        std::lock_guard lock(r.mutex);
+
+        auto* track = new TraceTrack();
+        track->id = static_cast<uint32_t>(r.tracks.size() + 1);
+        r.tracks.push_back(track);
+        return track;
+    }();
+
+    return *track;
+}
+
+uint64_t trace_now()
+{
+    static const auto epoch = std::chrono::steady_clock::now();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+}
+
+void trace_zone(const char* name, uint64_t begin, uint64_t end)
+{
+    thread_track().write(name, begin, end);
+}
+
+void trace_gpu(const char* name, uint64_t begin, uint64_t end)
+{
+    // Only the render thread submits work, so the GPU track has a single writer too
+    registry().gpu.write(name, begin, end);
+}
+
+void trace_thread_name(const char* name)
+{
+    thread_track().name.store(name, std::memory_order_relaxed);
+}
+
+static void write_json_string(std::ofstream& ofs, const char* text)
+{
+    ofs << '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            ofs << '\\';
+        }
+        ofs << *c;
+    }
+    ofs << '"';
+}
+
+static void write_track(std::ofstream& ofs, const TraceTrack& track, bool& first)
+{
+    auto separator = [&] {
+        ofs << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    auto* name = track.name.load(std::memory_order_relaxed);
+    if (name) {
+        separator();
+        ofs << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << track.id << R"(,"args":{"name":)";
+        write_json_string(ofs, name);
+        ofs << "}}";
+    }
+
+    auto head = track.head.load(std::memory_order_acquire);
+    auto first_index = head > TRACE_RING_SIZE ? head - TRACE_RING_SIZE : 0;
+
+    std::vector<std::tuple<const char*, uint64_t, uint64_t>> zones;
+    for (auto i = first_index; i < head; i++) {
+        auto& slot = track.slots[i % TRACE_RING_SIZE];
+        zones.emplace_back(slot.name.load(std::memory_order_relaxed), slot.begin.load(std::memory_order_relaxed), slot.end.load(std::memory_order_relaxed));
+    }
+
+    // Slots overwritten while they were copied may be torn, so they are dropped. Any
+    // slot store seen above is ordered after the begun store of its zone
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto begun = track.begun.load(std::memory_order_relaxed);
+    auto valid_index = begun > TRACE_RING_SIZE ? begun - TRACE_RING_SIZE : 0;
+    auto overwritten = valid_index > first_index ? valid_index - first_index : 0;
+
+    for (auto i = std::min<size_t>(overwritten, zones.size()); i < zones.size(); i++) {
+        auto [zone_name, begin, end] = zones[i];
+
+        separator();
+        ofs << R"({"name":)";
+        write_json_string(ofs, zone_name);
+        ofs << R"(,"ph":"X","pid":1,"tid":)" << track.id
+            << R"(,"ts":)" << static_cast<double>(begin) / 1000.0
+            << R"(,"dur":)" << static_cast<double>(end - begin) / 1000.0 << "}";
+    }
+}
+
+bool write_trace(const char* path)
+{
+    std::ofstream ofs(path);
+    if (!ofs.good()) {
+        warning("Failed to open {} for writing", path);
+        return false;
+    }
+
+    ofs.precision(3);
+    ofs << std::fixed << R"({"displayTimeUnit":"ms","traceEvents":[)";
+
+    auto& r = registry();
+    bool first = true;
+
+    write_track(ofs, r.gpu, first);
+    {
+        std::lock_guard lock(r.mutex);
+        for (auto* track : r.tracks) {
+            write_track(ofs, *track, first);
+        }
+    }
+
+    ofs << "\n]}\n";
+
+    return ofs.good();
+}
+}
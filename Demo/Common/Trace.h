@@ -0,0 +1,46 @@
+#pragma once
+
+#include <Demo/Common/Types.h>
+
+namespace Demo {
+// Nanoseconds since the first call, shared by all threads
+uint64_t trace_now();
+
+// Names must be string literals or otherwise outlive the process, only pointers are recorded.
+// Writes go to a ring buffer owned by the calling thread and never take a lock
+void trace_zone(const char* name, uint64_t begin, uint64_t end);
+
+// GPU work has its own track, times are CPU clock estimates of when the GPU ran it
+void trace_gpu(const char* name, uint64_t begin, uint64_t end);
+
+// Labels the track of the calling thread, name must outlive the process
+void trace_thread_name(const char* name);
+
+// Chrome trace event format, opens in chrome://tracing or Perfetto. Only the most
+// recent zones of every thread are kept
+bool write_trace(const char* path);
+
+class TraceZone : NonCopyable {
+public:
+    explicit TraceZone(const char* name)
+        : m_name(name)
+        , m_begin(trace_now())
+    {
+    }
+
+    ~TraceZone()
+    {
+        trace_zone(m_name, m_begin, trace_now());
+    }
+
+private:
+    const char* m_name;
+    uint64_t m_begin;
+};
+
+#define DM_TRACE_CONCAT_IMPL(a, b) a##b
+#define DM_TRACE_CONCAT(a, b) DM_TRACE_CONCAT_IMPL(a, b)
+
+// Records the rest of the enclosing block as one zone
+#define TRACE_ZONE(name) ::Demo::TraceZone DM_TRACE_CONCAT(trace_zone_, __LINE__)(name)
+}
@@ -4,4 +4,16 @@
 
 namespace Demo {
 constexpr uint64_t TIMEOUT = 5'000'000'000; // 5 seconds (in nanoseconds)
+constexpr uint32_t FRAMES_IN_FLIGHT = 2; // How many frames CPU can record ahead of GPU
+constexpr uint64_t UPLOAD_ARENA_SIZE = 4 * 1024 * 1024; // Transient upload memory per frame in flight
+constexpr uint64_t STAGING_BUFFER_SIZE = 32 * 1024 * 1024; // Host memory for uploads to device local memory
+constexpr const char* PIPELINE_CACHE_PATH = "pipeline_cache.bin"; // Relative to the working directory
+constexpr const char* MESH_CACHE_EXTENSION = ".meshcache"; // Appended to the path of the source asset
+constexpr uint32_t SAMPLES_PER_FRAME = 4; // Paths traced per pixel by every frame, specializes SAMPLES in pathtrace.comp
+constexpr uint32_t MAX_BOUNCES = 4; // Rays traced per path at most, specializes MAX_BOUNCES in pathtrace.comp
+constexpr float MESH_NEAR_PLANE = 0.01f; // Near clip distance of the raster mesh overlay
+constexpr float MESH_FAR_PLANE = 100.0f; // Far clip distance of the raster mesh overlay
+constexpr uint32_t GPU_PROFILER_HISTORY = 256; // Frames of GPU timings kept for rolling statistics
+constexpr const char* TRACE_PATH = "trace.json"; // Written when F12 is pressed, relative to the working directory
+constexpr bool DYNAMIC_RENDERING = true; // Use VK_KHR_dynamic_rendering instead of render pass objects when the device supports it
 }
@@ -9,7 +9,9 @@ DescriptorSetAllocator::DescriptorSetAllocator(VkDevice device)
 
     std::array pool_sizes = {
         VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 16},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 16},
         VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 16},
+        VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 16},
     };
 
     VkDescriptorPoolCreateInfo descriptor_pool_create_info = {
@@ -79,15 +81,37 @@ DescriptorSet::DescriptorSet(VkDevice device, DescriptorSetAllocator& allocator,
 
     m_set = allocator.allocate(m_layout);
 
+    write(bindings);
+}
+
+static bool is_image_descriptor(VkDescriptorType type)
+{
+    switch (type) {
+    case VK_DESCRIPTOR_TYPE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+    case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+    case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+    case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+void DescriptorSet::write(const std::vector<DescriptorBinding>& bindings)
+{
     std::vector<VkWriteDescriptorSet> writes;
     for (const auto& binding : bindings) {
+        bool is_image = is_image_descriptor(binding.descriptor_type);
+
         VkWriteDescriptorSet write_descriptor_set = {
             .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
             .dstSet = m_set,
             .dstBinding = binding.binding,
             .descriptorCount = 1,
             .descriptorType = binding.descriptor_type,
-            .pBufferInfo = &binding.buffer_info,
+            .pImageInfo = is_image ? &binding.image_info : nullptr,
+            .pBufferInfo = is_image ? nullptr : &binding.buffer_info,
         };
 
         writes.push_back(write_descriptor_set);
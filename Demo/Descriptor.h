@@ -33,6 +33,7 @@ private:
 struct DescriptorBinding {
     uint32_t binding;
     VkDescriptorBufferInfo buffer_info;
+    VkDescriptorImageInfo image_info;
     VkDescriptorType descriptor_type;
     VkShaderStageFlags stages;
 };
@@ -43,6 +44,9 @@ public:
     DescriptorSet(VkDevice device, DescriptorSetAllocator& allocator, std::vector<DescriptorBinding> bindings);
     ~DescriptorSet();
 
+    // Points bindings to other resources, e.g. after they were recreated on resize
+    void write(const std::vector<DescriptorBinding>& bindings);
+
     VkDescriptorSetLayout layout() const { return m_layout; }
     VkDescriptorSet raw() const { return m_set; }
     const VkDescriptorSet* as_ptr() const { return &m_set; }
@@ -18,16 +18,30 @@ Vector3 FlyCamera::position() const
     return m_position;
 }
 
-Vector3 FlyCamera::look_dir() const
+// Camera looks down +X when both angles are zero
+constexpr Vector3 FORWARD = {1.0f, 0.0f, 0.0f};
+constexpr Vector3 RIGHT = {0.0f, 0.0f, 1.0f};
+
+// Positive yaw turns from +X towards +Z
+static Quaternion yaw_rotation(float yaw)
+{
+    return Quaternion::axis_angle(Vector3::up(), -radians(yaw));
+}
+
+Quaternion FlyCamera::orientation() const
 {
-    float pitch = radians(m_pitch);
-    float yaw = radians(m_yaw);
+    auto pitch = Quaternion::axis_angle(RIGHT, radians(m_pitch));
+    return yaw_rotation(m_yaw) * pitch;
+}
 
-    float x = std::cos(yaw) * std::cos(pitch);
-    float y = std::sin(pitch);
-    float z = std::sin(yaw) * std::cos(pitch);
+Vector3 FlyCamera::look_dir() const
+{
+    return Demo::rotate(orientation(), FORWARD);
+}
 
-    return {x, y, z};
+Matrix4 FlyCamera::view() const
+{
+    return Matrix4::look_at(m_position, m_position + look_dir(), Vector3::up());
 }
 
 void FlyCamera::rotate(float dx, float dy)
@@ -44,9 +58,10 @@ void FlyCamera::rotate(float dx, float dy)
 
 void FlyCamera::move(MovementDirection direction)
 {
-    auto dir = look_dir();
-    auto right = normalize(cross(dir, Vector3::up()));
-    auto forward = normalize(Vector3(dir.x, 0, dir.z));
+    // Movement stays horizontal regardless of pitch
+    auto yaw = yaw_rotation(m_yaw);
+    auto right = Demo::rotate(yaw, RIGHT);
+    auto forward = Demo::rotate(yaw, FORWARD);
 
     switch (direction) {
     case MovementDirection::Forward:
@@ -18,6 +18,8 @@ public:
 
     Vector3 position() const;
     Vector3 look_dir() const;
+    Quaternion orientation() const;
+    Matrix4 view() const;
 
     void rotate(float dx, float dy);
     void move(MovementDirection direction);
@@ -0,0 +1,186 @@
+#include <Demo/Common/Log.h>
+#include <Demo/GpuProfiler.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Demo {
+// Two queries per scope
+constexpr uint32_t MAX_QUERIES = 64;
+
+static uint32_t timestamp_valid_bits(VkPhysicalDevice physical_device, const std::vector<uint32_t>& queue_families)
+{
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, nullptr);
+    std::vector<VkQueueFamilyProperties> properties(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(physical_device, &count, properties.data());
+
+    uint32_t valid_bits = 64;
+    for (auto family : queue_families) {
+        valid_bits = std::min(valid_bits, properties[family].timestampValidBits);
+    }
+
+    return valid_bits;
+}
+
+GpuProfiler::GpuProfiler(VkDevice device, VkPhysicalDevice physical_device, const std::vector<uint32_t>& queue_families)
+{
+    m_device = device;
+    m_frames.resize(FRAMES_IN_FLIGHT);
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    m_timestamp_period = properties.limits.timestampPeriod;
+
+    auto valid_bits = timestamp_valid_bits(physical_device, queue_families);
+    if (valid_bits == 0) {
+        warning("Queues don't support timestamps, GPU profiling is disabled");
+        return;
+    }
+
+    m_timestamp_mask = valid_bits == 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+    VkQueryPoolCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = MAX_QUERIES,
+    };
+
+    // Queries must be reset before their first use
+    for (auto& frame : m_frames) {
+        VK_ASSERT(vkCreateQueryPool(m_device, &create_info, nullptr, &frame.query_pool));
+        vkResetQueryPool(m_device, frame.query_pool, 0, MAX_QUERIES);
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (m_device) {
+        for (auto& frame : m_frames) {
+            vkDestroyQueryPool(m_device, frame.query_pool, nullptr);
+        }
+    }
+}
+
+void GpuProfiler::begin_frame(uint32_t frame_index)
+{
+    m_frame_index = frame_index;
+    m_last_frame.clear();
+    auto& frame = m_frames[frame_index];
+
+    if (frame.scopes.empty()) {
+        return;
+    }
+
+    auto query_count = static_cast<uint32_t>(frame.scopes.size() * 2);
+    uint64_t timestamps[MAX_QUERIES] = {};
+
+    // Fence of the frame was signaled, so waiting for availability would never block.
+    // Anything else means the frame was never submitted and its results are dropped
+    auto result = vkGetQueryPoolResults(m_device, frame.query_pool, 0, query_count, query_count * sizeof(uint64_t), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (result == VK_SUCCESS) {
+        auto to_ns = [&](uint64_t ticks) {
+            return static_cast<uint64_t>(static_cast<double>(ticks & m_timestamp_mask) * m_timestamp_period);
+        };
+
+        // Scopes are recorded out of order, e.g. into secondary command buffers, so the
+        // earliest begin timestamp of a queue family is where its part of the frame started
+        auto queue_begin = [&](uint32_t queue_family) {
+            auto begin = ~0ull;
+            for (auto& scope : frame.scopes) {
+                if (scope.queue_family == queue_family) {
+                    begin = std::min(begin, timestamps[scope.query] & m_timestamp_mask);
+                }
+            }
+
+            return begin;
+        };
+
+        for (auto& scope : frame.scopes) {
+            auto frame_begin = queue_begin(scope.queue_family);
+            auto begin = to_ns(timestamps[scope.query] - frame_begin);
+            auto end = to_ns(timestamps[scope.query + 1] - frame_begin);
+
+            record(scope.name, static_cast<float>(end - begin) / 1e6f);
+            m_last_frame.push_back({.name = scope.name, .queue_family = scope.queue_family, .begin = begin, .end = end});
+        }
+    }
+
+    // Fence wait made the frame's queries unused on the device
+    vkResetQueryPool(m_device, frame.query_pool, 0, query_count);
+    frame.scopes.clear();
+}
+
+uint32_t GpuProfiler::begin_scope(VkCommandBuffer cmd, uint32_t queue_family, const char* name)
+{
+    if (!enabled()) {
+        return 0;
+    }
+
+    auto& frame = m_frames[m_frame_index];
+    uint32_t query = 0;
+    {
+        std::lock_guard lock(*m_mutex);
+        query = static_cast<uint32_t>(frame.scopes.size() * 2);
+        ASSERT(query + 2 <= MAX_QUERIES, "Too many GPU profiler scopes in one frame");
+
+        frame.scopes.push_back({.name = name, .queue_family = queue_family, .query = query});
+    }
+
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.query_pool, query);
+
+    return query;
+}
+
+void GpuProfiler::end_scope(VkCommandBuffer cmd, uint32_t query)
+{
+    if (enabled()) {
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_frames[m_frame_index].query_pool, query + 1);
+    }
+}
+
+void GpuProfiler::record(const char* name, float time_ms)
+{
+    auto it = std::find_if(m_history.begin(), m_history.end(), [&](const History& history) {
+        return history.name == name;
+    });
+
+    if (it == m_history.end()) {
+        m_history.push_back({.name = name});
+        it = m_history.end() - 1;
+    }
+
+    if (it->samples_ms.size() < GPU_PROFILER_HISTORY) {
+        it->samples_ms.push_back(time_ms);
+    } else {
+        it->samples_ms[it->next] = time_ms;
+    }
+
+    it->next = (it->next + 1) % GPU_PROFILER_HISTORY;
+}
+
+std::vector<GpuScopeStats> GpuProfiler::stats() const
+{
+    std::vector<GpuScopeStats> stats;
+
+    for (auto& history : m_history) {
+        auto samples = history.samples_ms;
+        std::sort(samples.begin(), samples.end());
+
+        float sum = 0.0f;
+        for (auto sample : samples) {
+            sum += sample;
+        }
+
+        stats.push_back({
+            .name = history.name,
+            .min_ms = samples.front(),
+            .average_ms = sum / static_cast<float>(samples.size()),
+            .p99_ms = samples[samples.size() * 99 / 100],
+        });
+    }
+
+    return stats;
+}
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <Demo/Config.h>
+#include <Demo/RendererBase.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Demo {
+// Nanoseconds since the first timestamp the frame wrote on the same queue family. Timestamps
+// are only guaranteed to be comparable within one queue
+struct GpuScopeTime {
+    const char* name;
+    uint32_t queue_family;
+    uint64_t begin;
+    uint64_t end;
+};
+
+struct GpuScopeStats {
+    std::string name;
+    float min_ms;
+    float average_ms;
+    float p99_ms;
+};
+
+// Times scopes of command buffers with pairs of timestamp queries. Every frame in flight
+// has its own query pool, which is read back once the frame's fence was waited for, so
+// results arrive FRAMES_IN_FLIGHT frames late but never stall the CPU
+class GpuProfiler : NonCopyable {
+public:
+    GpuProfiler() = default;
+
+    // Scopes are only timed if all of the queue families support timestamps
+    GpuProfiler(VkDevice device, VkPhysicalDevice physical_device, const std::vector<uint32_t>& queue_families);
+    ~GpuProfiler();
+
+    bool enabled() const { return m_timestamp_mask != 0; }
+
+    // Frame must have finished on the GPU, its results are collected and its queries are
+    // reset from the host, so no command buffer has to be ordered before the frame's scopes
+    void begin_frame(uint32_t frame_index);
+
+    // Name must outlive the profiler, scopes with the same name are aggregated. Command buffer
+    // must be submitted to the first queue of the family. May be recorded from several threads,
+    // e.g. into secondary command buffers
+    template<typename F>
+    void scope(VkCommandBuffer cmd, uint32_t queue_family, const char* name, F f)
+    {
+        auto query = begin_scope(cmd, queue_family, name);
+        f();
+        end_scope(cmd, query);
+    }
+
+    // Rolling statistics over the last GPU_PROFILER_HISTORY frames, in order of first appearance
+    std::vector<GpuScopeStats> stats() const;
+
+    // Drops the statistics, e.g. of warmup frames. Frames already in flight are still recorded
+    void clear_history() { m_history.clear(); }
+
+    // Scopes of the frame collected by the last begin_frame(), empty if there were none
+    const std::vector<GpuScopeTime>& last_frame() const { return m_last_frame; }
+
+    GpuProfiler(GpuProfiler&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    GpuProfiler& operator=(GpuProfiler&& other) noexcept
+    {
+        swap(m_device, other.m_device);
+        swap(m_frames, other.m_frames);
+        swap(m_frame_index, other.m_frame_index);
+        swap(m_mutex, other.m_mutex);
+        swap(m_timestamp_period, other.m_timestamp_period);
+        swap(m_timestamp_mask, other.m_timestamp_mask);
+        swap(m_history, other.m_history);
+        swap(m_last_frame, other.m_last_frame);
+
+        return *this;
+    }
+
+private:
+    struct Scope {
+        const char* name = nullptr;
+        uint32_t queue_family = 0;
+        uint32_t query = 0; // Begin timestamp, end timestamp follows it
+    };
+
+    struct Frame {
+        VkQueryPool query_pool = VK_NULL_HANDLE;
+        std::vector<Scope> scopes = {};
+    };
+
+    struct History {
+        std::string name;
+        std::vector<float> samples_ms = {}; // Ring buffer
+        uint32_t next = 0;
+    };
+
+    uint32_t begin_scope(VkCommandBuffer cmd, uint32_t queue_family, const char* name);
+    void end_scope(VkCommandBuffer cmd, uint32_t query);
+    void record(const char* name, float time_ms);
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<Frame> m_frames = {};
+    uint32_t m_frame_index = 0;
+
+    // Guards scopes of the frame being recorded
+    std::unique_ptr<std::mutex> m_mutex = std::make_unique<std::mutex>();
+
+    float m_timestamp_period = 0.0f; // Nanoseconds per tick
+    uint64_t m_timestamp_mask = 0;
+
+    std::vector<History> m_history = {};
+    std::vector<GpuScopeTime> m_last_frame = {};
+};
+}
@@ -0,0 +1,67 @@
+#include <Demo/Image.h>
+
+namespace Demo {
+Image::Image(VkDevice device, VmaAllocator allocator, Vector2u size, VkFormat format, VkImageUsageFlags usage, const std::vector<uint32_t>& queue_families)
+{
+    m_device = device;
+    m_allocator = allocator;
+    m_format = format;
+    m_size = size;
+
+    bool concurrent = queue_families.size() > 1;
+
+    VkImageCreateInfo image_create_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = format,
+        .extent = {size.width, size.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = usage,
+        .sharingMode = concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = concurrent ? static_cast<uint32_t>(queue_families.size()) : 0,
+        .pQueueFamilyIndices = concurrent ? queue_families.data() : nullptr,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    VmaAllocationCreateInfo allocation_create_info = {
+        .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+    };
+
+    auto result = vmaCreateImage(allocator, &image_create_info, &allocation_create_info, &m_image, &m_allocation, nullptr);
+    VK_ASSERT(result);
+
+    VkImageViewCreateInfo view_create_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = m_image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = format,
+        .components = {
+            .r = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .g = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .b = VK_COMPONENT_SWIZZLE_IDENTITY,
+            .a = VK_COMPONENT_SWIZZLE_IDENTITY,
+        },
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
+
+    result = vkCreateImageView(m_device, &view_create_info, nullptr, &m_view);
+    VK_ASSERT(result);
+}
+
+Image::~Image()
+{
+    if (m_device) {
+        vkDestroyImageView(m_device, m_view, nullptr);
+        vmaDestroyImage(m_allocator, m_image, m_allocation);
+    }
+}
+}
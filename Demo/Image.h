@@ -0,0 +1,48 @@
+#pragma once
+
+#include <Demo/RendererBase.h>
+#include <vk_mem_alloc.h>
+
+#include <vector>
+
+namespace Demo {
+class Image : NonCopyable {
+public:
+    Image() = default;
+    // Image is shared concurrently when it's accessed from more than one queue family
+    Image(VkDevice device, VmaAllocator allocator, Vector2u size, VkFormat format, VkImageUsageFlags usage, const std::vector<uint32_t>& queue_families = {});
+    ~Image();
+
+    VkImage raw() const { return m_image; }
+    VkImageView view() const { return m_view; }
+    VkFormat format() const { return m_format; }
+    Vector2u size() const { return m_size; }
+
+    Image(Image&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    Image& operator=(Image&& other) noexcept
+    {
+        swap(m_device, other.m_device);
+        swap(m_allocator, other.m_allocator);
+        swap(m_image, other.m_image);
+        swap(m_view, other.m_view);
+        swap(m_allocation, other.m_allocation);
+        swap(m_format, other.m_format);
+        swap(m_size, other.m_size);
+
+        return *this;
+    }
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+    VkImage m_image = VK_NULL_HANDLE;
+    VkImageView m_view = VK_NULL_HANDLE;
+    VmaAllocation m_allocation = VK_NULL_HANDLE;
+    VkFormat m_format = VK_FORMAT_UNDEFINED;
+    Vector2u m_size = {0, 0};
+};
+}
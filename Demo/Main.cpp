@@ -1,24 +1,85 @@
+#include <Demo/BVH.h>
 #include <Demo/Common/Base.h>
 #include <Demo/Common/Log.h>
+#include <Demo/Common/Trace.h>
 #include <Demo/Common/Types.h>
+#include <Demo/Config.h>
 #include <Demo/FlyCamera.h>
 #include <Demo/Math.h>
 #include <Demo/Mesh.h>
+#include <Demo/MeshCache.h>
+#include <Demo/MeshImporter.h>
+#include <Demo/ReferenceTracer.h>
 #include <Demo/Renderer.h>
+#include <Demo/Scene.h>
 #include <Demo/Window.h>
 #include <GLFW/glfw3.h>
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_vulkan.h>
 #include <imgui.h>
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
 #include <typeinfo>
+#include <vector>
 
 namespace Demo {
-void init()
+struct Options {
+    bool headless = false;
+    // Renders the headless scene with ReferenceTracer instead of the GPU
+    bool reference = false;
+    // Replays BENCHMARK_PATH, offscreen if combined with --headless
+    bool benchmark = false;
+    const char* results = "benchmark.json";
+    uint32_t frames = 64;
+    const char* output = "output.ppm";
+    // OBJ or GLB file added to the scene
+    const char* mesh = nullptr;
+};
+
+Options parse_options(int argc, char** argv)
 {
-    ASSERT(glfwInit());
+    Options options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+
+        if (arg == "--headless") {
+            options.headless = true;
+        } else if (arg == "--reference") {
+            options.reference = true;
+        } else if (arg == "--benchmark") {
+            options.benchmark = true;
+        } else if (arg == "--results" && i + 1 < argc) {
+            options.results = argv[++i];
+        } else if (arg == "--frames" && i + 1 < argc) {
+            options.frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (arg == "--mesh" && i + 1 < argc) {
+            options.mesh = argv[++i];
+        } else {
+            warning("Unknown argument: {}", arg);
+        }
+    }
+
+    return options;
+}
+
+void init(const Options& options)
+{
+    // Headless mode must work on machines without any display
+    if (!options.headless && !options.reference) {
+        ASSERT(glfwInit());
+    }
+
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
 }
@@ -29,19 +90,6 @@ void terminate()
     glfwTerminate();
 }
 
-struct Uniforms {
-    float time;
-    float aspect_ratio;
-    float fov;
-    float width;
-    float height;
-};
-
-struct Camera {
-    Vector4 position;
-    Vector4 look_dir;
-};
-
 enum class InteractionMode {
     UI,
     Camera,
@@ -49,9 +97,11 @@ enum class InteractionMode {
 
 struct Stats {
     float time_ms;
+    uint32_t accumulated_frames;
+    std::vector<GpuScopeStats> gpu_scopes;
 };
 
-void show_stats(Stats stats)
+void show_stats(const Stats& stats)
 {
     auto flags = ImGuiWindowFlags_NoDocking
         | ImGuiWindowFlags_NoNav
@@ -72,18 +122,129 @@ void show_stats(Stats stats)
     ImGui::Begin("stats", nullptr, flags);
     {
         ImGui::Text("Frame rate: %dfps  Time: %.02fms", static_cast<int>(std::round(1000 / stats.time_ms)), stats.time_ms);
+        ImGui::Text("Accumulated frames: %u", stats.accumulated_frames);
+
+        // Present isn't recorded into a command buffer, so it shows up as the gap between frame time and GPU scopes
+        for (auto& scope : stats.gpu_scopes) {
+            ImGui::Text("%-12s min %.02fms  avg %.02fms  p99 %.02fms", scope.name.c_str(), scope.min_ms, scope.average_ms, scope.p99_ms);
+        }
     }
     ImGui::End();
     ImGui::PopStyleColor(2);
     ImGui::PopStyleVar(3);
 }
 
-void run()
+Mesh create_sphere(Vector3 center, float radius, uint32_t rings, uint32_t segments)
 {
-    Window window("Demo", {1280, 720});
-    window.set_size_limits({320, 180}, SIZE_UNBOUNDED);
+    Mesh mesh;
+
+    auto vertex = [&](uint32_t ring, uint32_t segment) {
+        float theta = PI * static_cast<float>(ring) / static_cast<float>(rings);
+        float phi = 2 * PI * static_cast<float>(segment) / static_cast<float>(segments);
+
+        Vector3 normal(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+
+        return Vertex{
+            .position = center + normal * radius,
+            .normal = normal,
+            .uv = Vector2(static_cast<float>(segment) / static_cast<float>(segments), static_cast<float>(ring) / static_cast<float>(rings)),
+        };
+    };
+
+    for (uint32_t ring = 0; ring < rings; ring++) {
+        for (uint32_t segment = 0; segment < segments; segment++) {
+            mesh.add_vertex(vertex(ring, segment));
+            mesh.add_vertex(vertex(ring + 1, segment));
+            mesh.add_vertex(vertex(ring + 1, segment + 1));
+
+            mesh.add_vertex(vertex(ring, segment));
+            mesh.add_vertex(vertex(ring + 1, segment + 1));
+            mesh.add_vertex(vertex(ring, segment + 1));
+        }
+    }
+
+    return mesh;
+}
+
+// One cache per vertex format is written next to the source asset
+std::string mesh_cache_path(const char* path, VertexFormat format)
+{
+    return std::string(path) + (format == VertexFormat::Float ? "" : ".packed") + MESH_CACHE_EXTENSION;
+}
+
+// Mapping is released before returning, so a stale cache can be replaced
+bool is_mesh_cache_current(const std::string& cache_path, MeshSource source, VertexFormat format)
+{
+    MeshCache cache(cache_path.c_str());
+    return cache.is_valid() && cache.source() == source && cache.format() == format;
+}
+
+// Warm starts read the caches which the first run writes
+Mesh load_mesh(const char* path)
+{
+    auto cache_path = mesh_cache_path(path, VertexFormat::Float);
+    auto source = mesh_source(path);
+
+    // The BVH is built on the CPU, which needs exact float vertices
+    Mesh mesh;
+    if (is_mesh_cache_current(cache_path, source, VertexFormat::Float)) {
+        info("Loaded {} from {}", path, cache_path);
+        mesh = MeshCache(cache_path.c_str()).to_mesh();
+    } else {
+        mesh = import_mesh(path);
+        if (!mesh.indexed()) {
+            mesh.build_indexed();
+        }
 
-    GraphicsPass pass{
+        write_mesh_cache(cache_path, mesh, VertexFormat::Float, source);
+    }
+
+    // Renderer uploads the streams of this one straight from the mapped file
+    auto gpu_cache_path = mesh_cache_path(path, MESH_VERTEX_FORMAT);
+    if (!is_mesh_cache_current(gpu_cache_path, source, MESH_VERTEX_FORMAT)) {
+        write_mesh_cache(gpu_cache_path, mesh, MESH_VERTEX_FORMAT, source);
+    }
+
+    return mesh;
+}
+
+BVH create_scene(const Options& options)
+{
+    BVH bvh;
+
+    constexpr float ground = -1.5f;
+    constexpr float extent = 20.0f;
+
+    Vector3 ground_albedo(0.5f, 0.5f, 0.5f);
+    bvh.add_triangle({-extent, ground, -extent}, {extent, ground, -extent}, {extent, ground, extent}, ground_albedo);
+    bvh.add_triangle({-extent, ground, -extent}, {extent, ground, extent}, {-extent, ground, extent}, ground_albedo);
+
+    for (int x = -4; x <= 4; x++) {
+        for (int z = -4; z <= 4; z++) {
+            float height = 0.1f + 0.05f * static_cast<float>((x * 7 + z * 13) & 7);
+            Vector3 center(1.5f * static_cast<float>(x), ground + height, 1.5f * static_cast<float>(z));
+            Vector3 albedo(0.2f + 0.08f * static_cast<float>(x + 4), 0.6f, 0.2f + 0.08f * static_cast<float>(z + 4));
+
+            bvh.add_box(center, {0.2f, height, 0.2f}, albedo);
+        }
+    }
+
+    auto sphere = create_sphere({2.0f, -0.9f, -1.0f}, 0.6f, 64, 128);
+    sphere.build_indexed();
+    bvh.add_mesh(sphere, {0.8f, 0.3f, 0.3f});
+
+    if (options.mesh) {
+        bvh.add_mesh(load_mesh(options.mesh), {0.7f, 0.7f, 0.7f});
+    }
+
+    bvh.build();
+
+    return bvh;
+}
+
+GraphicsPass create_pass(const BVH& bvh)
+{
+    return GraphicsPass{
         .uniform_buffers = {
             UniformBuffer{
                 .binding = 0,
@@ -97,10 +258,322 @@ void run()
         .storage_buffers = {
             UniformBuffer{
                 .binding = 2,
-                .buffer_size = sizeof(float),
+                .buffer_size = bvh.nodes().size() * sizeof(BVHNode),
+            },
+            UniformBuffer{
+                .binding = 4,
+                .buffer_size = bvh.primitives().size() * sizeof(BVHPrimitive),
+            },
+            UniformBuffer{
+                .binding = 6,
+                .buffer_size = sizeof(RayCounter),
             },
         },
     };
+}
+
+void write_ppm(const char* path, Vector2u size, const std::vector<uint8_t>& bgra)
+{
+    std::ofstream ofs(path, std::ios::binary);
+    ASSERT(ofs.good());
+
+    ofs << "P6\n"
+        << size.width << " " << size.height << "\n255\n";
+
+    for (size_t i = 0; i < bgra.size(); i += 4) {
+        char rgb[] = {
+            static_cast<char>(bgra[i + 2]),
+            static_cast<char>(bgra[i + 1]),
+            static_cast<char>(bgra[i + 0]),
+        };
+
+        ofs.write(rgb, sizeof(rgb));
+    }
+}
+
+void run_headless(const Options& options)
+{
+    Vector2u size(1280, 720);
+
+    auto scene = create_scene(options);
+    Renderer renderer(size, create_pass(scene));
+    renderer.update(2, scene.nodes());
+    renderer.update(3, scene.primitives());
+
+    FlyCamera fly_camera({-1.0f, -1.0f, -1.0f}, 0.1f, 0.2f);
+
+    auto then = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        // Static scene lets every frame accumulate into a single converged image
+        Uniforms uniforms = {
+            .time = 0.0f,
+            .aspect_ratio = static_cast<float>(size.width) / static_cast<float>(size.height),
+            .fov = 90.0f,
+            .width = static_cast<float>(size.width),
+            .height = static_cast<float>(size.height),
+        };
+
+        Camera camera = {
+            .position = Vector4(fly_camera.position(), 0.0f),
+            .look_dir = Vector4(fly_camera.look_dir(), 0.0f),
+        };
+
+        renderer.update(0, uniforms);
+        renderer.update(1, camera);
+        renderer.render();
+    }
+
+    auto pixels = renderer.read_back();
+
+    auto elapsed = std::chrono::high_resolution_clock::now() - then;
+    info("Rendered {} frames in {:.02f}ms", options.frames, std::chrono::duration<float, std::milli>(elapsed).count());
+
+    write_ppm(options.output, size, pixels);
+    info("Saved {}", options.output);
+}
+
+void run_reference(const Options& options)
+{
+    Vector2u size(1280, 720);
+
+    auto scene = create_scene(options);
+    ReferenceTracer tracer(scene, size);
+
+    FlyCamera fly_camera({-1.0f, -1.0f, -1.0f}, 0.1f, 0.2f);
+
+    // Same uniforms as run_headless(), so both images converge to the same result
+    Uniforms uniforms = {
+        .time = 0.0f,
+        .aspect_ratio = static_cast<float>(size.width) / static_cast<float>(size.height),
+        .fov = 90.0f,
+        .width = static_cast<float>(size.width),
+        .height = static_cast<float>(size.height),
+    };
+
+    Camera camera = {
+        .position = Vector4(fly_camera.position(), 0.0f),
+        .look_dir = Vector4(fly_camera.look_dir(), 0.0f),
+    };
+
+    auto then = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t frame = 0; frame < options.frames; frame++) {
+        tracer.render(uniforms, camera, frame);
+    }
+
+    auto pixels = tracer.read_back();
+
+    auto elapsed = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - then).count();
+    auto samples = static_cast<float>(size.rectangle_area()) * static_cast<float>(options.frames) * static_cast<float>(SAMPLES_PER_FRAME);
+    info("Traced {} frames in {:.02f}ms, {:.02f}M paths/s", options.frames, elapsed * 1000.0f, samples / elapsed / 1e6f);
+
+    write_ppm(options.output, size, pixels);
+    info("Saved {}", options.output);
+}
+
+// Camera input replayed by --benchmark, held for a number of frames. The path loops
+// when more frames are requested than it covers
+struct BenchmarkStep {
+    uint32_t frames;
+    MovementDirection direction;
+    float dx;
+    float dy;
+};
+
+constexpr BenchmarkStep BENCHMARK_PATH[] = {
+    {60, MovementDirection::Forward, 0.0f, 0.0f},
+    {60, MovementDirection::Right, -4.0f, 0.0f},
+    {60, MovementDirection::Up, 0.0f, -1.0f},
+    {60, MovementDirection::Backward, 4.0f, 1.0f},
+    {60, MovementDirection::Down, 0.0f, 0.0f},
+    {60, MovementDirection::Left, 0.0f, 0.0f},
+};
+
+// Simulated time per frame, so the animated box is in the same place on every machine
+constexpr float BENCHMARK_TIME_STEP = 1.0f / 60.0f;
+
+// Pipeline creation and first uploads aren't representative of steady state
+constexpr uint32_t BENCHMARK_WARMUP_FRAMES = 8;
+
+static float percentile(const std::vector<float>& sorted, float fraction)
+{
+    auto index = static_cast<size_t>(fraction * static_cast<float>(sorted.size()));
+    return sorted[std::min<size_t>(index, sorted.size() - 1)];
+}
+
+void write_benchmark_results(const char* path, const Renderer& renderer, Vector2u size, std::vector<float> frame_times_ms, uint64_t rays)
+{
+    std::sort(frame_times_ms.begin(), frame_times_ms.end());
+
+    float total_ms = 0.0f;
+    for (auto time_ms : frame_times_ms) {
+        total_ms += time_ms;
+    }
+
+    auto frame_count = static_cast<float>(frame_times_ms.size());
+    auto samples = static_cast<float>(size.rectangle_area()) * static_cast<float>(SAMPLES_PER_FRAME) * frame_count;
+    auto samples_per_second = samples / (total_ms / 1000.0f);
+    auto rays_per_second = static_cast<float>(rays) / (total_ms / 1000.0f);
+    auto properties = renderer.device_properties();
+
+    std::ofstream ofs(path);
+    ASSERT(ofs.good());
+
+    ofs.precision(3);
+    ofs << std::fixed
+        << "{\n"
+        << "  \"device\": \"" << properties.deviceName << "\",\n"
+        << "  \"vendor_id\": " << properties.vendorID << ",\n"
+        << "  \"device_id\": " << properties.deviceID << ",\n"
+        << "  \"driver_version\": " << properties.driverVersion << ",\n"
+        << "  \"offscreen\": " << (renderer.headless() ? "true" : "false") << ",\n"
+        << "  \"width\": " << size.width << ",\n"
+        << "  \"height\": " << size.height << ",\n"
+        << "  \"frames\": " << frame_times_ms.size() << ",\n"
+        << "  \"frame_time_ms\": {"
+        << "\"average\": " << total_ms / frame_count
+        << ", \"p50\": " << percentile(frame_times_ms, 0.5f)
+        << ", \"p90\": " << percentile(frame_times_ms, 0.9f)
+        << ", \"p99\": " << percentile(frame_times_ms, 0.99f)
+        << ", \"max\": " << frame_times_ms.back() << "},\n"
+        << "  \"samples_per_second\": " << samples_per_second << ",\n"
+        << "  \"rays_per_second\": " << rays_per_second << ",\n"
+        << "  \"gpu_passes_ms\": {";
+
+    // Profiler keeps the last GPU_PROFILER_HISTORY frames, which is the end of the run
+    auto gpu_scopes = renderer.profiler().stats();
+    for (size_t i = 0; i < gpu_scopes.size(); i++) {
+        auto& scope = gpu_scopes[i];
+        ofs << (i > 0 ? ",\n" : "\n")
+            << "    \"" << scope.name << "\": {"
+            << "\"min\": " << scope.min_ms
+            << ", \"average\": " << scope.average_ms
+            << ", \"p99\": " << scope.p99_ms << "}";
+    }
+
+    ofs << (gpu_scopes.empty() ? "}\n" : "\n  }\n") << "}\n";
+
+    info("Benchmark: {} frames, {:.02f}ms average, {:.02f}ms p99, {:.02f}M samples/s, {:.02f}M rays/s",
+        frame_times_ms.size(), total_ms / frame_count, percentile(frame_times_ms, 0.99f), samples_per_second / 1e6f, rays_per_second / 1e6f);
+}
+
+void run_benchmark(const Options& options)
+{
+    Vector2u size(1280, 720);
+
+    auto scene = create_scene(options);
+    auto pass = create_pass(scene);
+
+    // Windowed runs include presentation and the UI, offscreen runs measure path tracing alone
+    std::optional<Window> window;
+    std::optional<Renderer> renderer;
+
+    if (options.headless) {
+        renderer.emplace(size, pass);
+    } else {
+        window.emplace("Demo", size);
+        size = window->size();
+        ImGui::StyleColorsDark();
+        ImGui_ImplGlfw_InitForVulkan(window->glfw_handle(), true);
+        renderer.emplace(*window, pass);
+    }
+
+    renderer->update(2, scene.nodes());
+    renderer->update(3, scene.primitives());
+
+    // Slower than interactive movement, so the whole path stays inside the scene
+    FlyCamera fly_camera({-1.0f, -1.0f, -1.0f}, 0.1f, 0.02f);
+
+    uint32_t step = 0;
+    uint32_t step_frame = 0;
+
+    std::vector<float> frame_times_ms;
+    auto then = std::chrono::high_resolution_clock::now();
+
+    for (uint32_t frame = 0; frame < BENCHMARK_WARMUP_FRAMES + options.frames; frame++) {
+        TRACE_ZONE("Frame");
+
+        if (window) {
+            glfwPollEvents();
+            if (window->close_requested()) {
+                break;
+            }
+
+            ImGui_ImplGlfw_NewFrame();
+            ImGui_ImplVulkan_NewFrame();
+            ImGui::NewFrame();
+        }
+
+        const auto& path_step = BENCHMARK_PATH[step];
+        fly_camera.rotate(path_step.dx, path_step.dy);
+        fly_camera.move(path_step.direction);
+
+        if (++step_frame == path_step.frames) {
+            step = (step + 1) % std::size(BENCHMARK_PATH);
+            step_frame = 0;
+        }
+
+        Uniforms uniforms = {
+            .time = static_cast<float>(frame) * BENCHMARK_TIME_STEP,
+            .aspect_ratio = static_cast<float>(size.width) / static_cast<float>(size.height),
+            .fov = 90.0f,
+            .width = static_cast<float>(size.width),
+            .height = static_cast<float>(size.height),
+        };
+
+        Camera camera = {
+            .position = Vector4(fly_camera.position(), 0.0f),
+            .look_dir = Vector4(fly_camera.look_dir(), 0.0f),
+        };
+
+        renderer->update(0, uniforms);
+        renderer->update(1, camera);
+        renderer->render();
+
+        if (window) {
+            ImGui::EndFrame();
+        }
+
+        // GPU results of a frame are collected FRAMES_IN_FLIGHT - 1 renders later, so this is
+        // the first render after which all of the warmup frames have been recorded
+        if (frame == BENCHMARK_WARMUP_FRAMES + FRAMES_IN_FLIGHT - 2) {
+            renderer->profiler().clear_history();
+        }
+
+        // Clearing waits for the warmup frames, which is still part of the last unmeasured frame
+        if (frame + 1 == BENCHMARK_WARMUP_FRAMES) {
+            renderer->update(4, RayCounter{});
+        }
+
+        auto now = std::chrono::high_resolution_clock::now();
+        if (frame >= BENCHMARK_WARMUP_FRAMES) {
+            frame_times_ms.push_back(std::chrono::duration<float, std::milli>(now - then).count());
+        }
+        then = now;
+    }
+
+    if (frame_times_ms.empty()) {
+        warning("Benchmark was interrupted before any frame was measured");
+    } else {
+        // Counts the rays of the measured frames, which are all the frames rendered since the clear
+        auto rays = renderer->read<RayCounter>(4).rays();
+        write_benchmark_results(options.results, *renderer, size, move(frame_times_ms), rays);
+        info("Saved {}", options.results);
+    }
+
+    if (window) {
+        ImGui_ImplGlfw_Shutdown();
+    }
+}
+
+void run(const Options& options)
+{
+    Window window("Demo", {1280, 720});
+    window.set_size_limits({320, 180}, SIZE_UNBOUNDED);
+
+    auto scene = create_scene(options);
+    auto pass = create_pass(scene);
 
     auto& imgui_io = ImGui::GetIO();
     imgui_io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;
@@ -108,6 +581,18 @@ void run()
     ImGui_ImplGlfw_InitForVulkan(window.glfw_handle(), true);
 
     Renderer renderer(window, pass);
+    renderer.update(2, scene.nodes());
+    renderer.update(3, scene.primitives());
+
+    // create_scene() wrote the cache, its streams are uploaded without being copied into a Mesh.
+    // Rasterizing it over the path traced image shows whether the packed vertices decode in place
+    GPUMesh mesh;
+    if (options.mesh) {
+        MeshCache cache(mesh_cache_path(options.mesh, MESH_VERTEX_FORMAT).c_str());
+        if (cache.is_valid()) {
+            mesh = renderer.create_mesh(cache);
+        }
+    }
 
     FlyCamera fly_camera({-1.0f, -1.0f, -1.0f}, 0.1f, 0.2f);
     InteractionMode mode = InteractionMode::Camera;
@@ -133,6 +618,12 @@ void run()
     });
 
     window.set_key_handler([&](int key, int scancode, int action, int mods) {
+        if (key == GLFW_KEY_F12 && action == GLFW_RELEASE) {
+            if (write_trace(TRACE_PATH)) {
+                info("Saved trace to {}", TRACE_PATH);
+            }
+        }
+
         if (key == GLFW_KEY_GRAVE_ACCENT && action == GLFW_RELEASE) {
             if (mode == InteractionMode::Camera) {
                 mode = InteractionMode::UI;
@@ -146,50 +637,77 @@ void run()
 
     float fov = 90.0f;
 
+    // Animating the scene restarts accumulation every frame
+    bool animate = false;
+    bool show_mesh = false;
+    float scene_time = 0.0f;
+
     auto then = std::chrono::high_resolution_clock::now();
 
     while (!window.close_requested()) {
-        glfwPollEvents();
+        TRACE_ZONE("Frame");
+
+        {
+            TRACE_ZONE("Poll events");
+            glfwPollEvents();
+        }
 
         auto now = std::chrono::high_resolution_clock::now();
         auto dt = now - then;
         then = now;
 
-        ImGui_ImplGlfw_NewFrame();
-        ImGui_ImplVulkan_NewFrame();
-        ImGui::NewFrame();
+        {
+            TRACE_ZONE("Build UI");
 
-        show_stats({
-            .time_ms = std::chrono::duration<float, std::milli>(dt).count(),
-        });
+            ImGui_ImplGlfw_NewFrame();
+            ImGui_ImplVulkan_NewFrame();
+            ImGui::NewFrame();
 
-        if (mode == InteractionMode::UI) {
-            ImGui::Begin("Settings", nullptr);
-            ImGui::SliderFloat("FOV", &fov, 40.0f, 140.0f, "%.0f", ImGuiSliderFlags_AlwaysClamp);
-            ImGui::End();
-        } else {
-            if (window.key_pressed(GLFW_KEY_ESCAPE))
-                break;
-            if (window.key_pressed(GLFW_KEY_W))
-                fly_camera.move(MovementDirection::Forward);
-            if (window.key_pressed(GLFW_KEY_S))
-                fly_camera.move(MovementDirection::Backward);
-            if (window.key_pressed(GLFW_KEY_A))
-                fly_camera.move(MovementDirection::Left);
-            if (window.key_pressed(GLFW_KEY_D))
-                fly_camera.move(MovementDirection::Right);
-            if (window.key_pressed(GLFW_KEY_SPACE))
-                fly_camera.move(MovementDirection::Up);
-            if (window.key_pressed(GLFW_KEY_LEFT_SHIFT))
-                fly_camera.move(MovementDirection::Down);
+            show_stats({
+                .time_ms = std::chrono::duration<float, std::milli>(dt).count(),
+                .accumulated_frames = renderer.accumulated_frames(),
+                .gpu_scopes = renderer.profiler().stats(),
+            });
+
+            if (animate) {
+                scene_time += std::chrono::duration<float>(dt).count();
+            }
+
+            if (mode == InteractionMode::UI) {
+                ImGui::Begin("Settings", nullptr);
+                ImGui::SliderFloat("FOV", &fov, 40.0f, 140.0f, "%.0f", ImGuiSliderFlags_AlwaysClamp);
+                ImGui::Checkbox("Animate", &animate);
+                if (mesh.vertex_count() > 0) {
+                    ImGui::Checkbox("Raster mesh", &show_mesh);
+                }
+                ImGui::End();
+            } else {
+                if (window.key_pressed(GLFW_KEY_ESCAPE))
+                    break;
+                if (window.key_pressed(GLFW_KEY_W))
+                    fly_camera.move(MovementDirection::Forward);
+                if (window.key_pressed(GLFW_KEY_S))
+                    fly_camera.move(MovementDirection::Backward);
+                if (window.key_pressed(GLFW_KEY_A))
+                    fly_camera.move(MovementDirection::Left);
+                if (window.key_pressed(GLFW_KEY_D))
+                    fly_camera.move(MovementDirection::Right);
+                if (window.key_pressed(GLFW_KEY_SPACE))
+                    fly_camera.move(MovementDirection::Up);
+                if (window.key_pressed(GLFW_KEY_LEFT_SHIFT))
+                    fly_camera.move(MovementDirection::Down);
+            }
         }
 
+        // Window may have been resized since the last frame
+        auto size = window.size();
+
         Uniforms uniforms = {
-            .time = static_cast<float>(glfwGetTime()),
-            .aspect_ratio = static_cast<float>(1280) / static_cast<float>(720),
+            .time = scene_time,
+            .aspect_ratio = static_cast<float>(size.width) / static_cast<float>(size.height),
             .fov = fov,
-            .width = static_cast<float>(1280),
-            .height = static_cast<float>(720),
+            .width = static_cast<float>(size.width),
+            .height = static_cast<float>(size.height),
         };
 
         Camera camera = {
@@ -197,22 +715,48 @@ void run()
             .look_dir = Vector4(fly_camera.look_dir(), 0.0f),
         };
 
-        renderer.update(0, uniforms);
-        renderer.update(1, camera);
+        {
+            TRACE_ZONE("Update");
+            renderer.update(0, uniforms);
+            renderer.update(1, camera);
+        }
+
+        // Same projection as the rays of pathtrace.comp, so both images of the mesh line up
+        if (show_mesh) {
+            auto projection = Matrix4::perspective(radians(fov), uniforms.aspect_ratio, MESH_NEAR_PLANE, MESH_FAR_PLANE);
+            renderer.draw_mesh(mesh, projection * fly_camera.view());
+        }
+
         renderer.render();
 
         ImGui::EndFrame();
     }
 
+    // Upload of the mesh may still be pending
+    renderer.wait_idle();
+
     ImGui_ImplGlfw_Shutdown();
 }
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    Demo::trace_thread_name("Main");
+
+    auto options = Demo::parse_options(argc, argv);
+
+    Demo::init(options);
+
+    if (options.reference) {
+        Demo::run_reference(options);
+    } else if (options.benchmark) {
+        Demo::run_benchmark(options);
+    } else if (options.headless) {
+        Demo::run_headless(options);
+    } else {
+        Demo::run(options);
+    }
 
-    Demo::init();
-    Demo::run();
     Demo::terminate();
 
     return 0;
@@ -1,54 +1,103 @@
 #include <Demo/Math.h>
 
-#include <cmath>
-
 namespace Demo {
-float radians(float degrees)
+// Kernels are written against a lane type, full registers use FloatN and the leftovers Float1
+template<typename T>
+static void transform_points(const Matrix4& m, PointArrays in, PointArrays out, size_t begin, size_t end)
 {
-    return degrees / 180.0f * PI;
-}
+    constexpr size_t width = sizeof(T) / sizeof(float);
 
-void Vector3::operator+=(Vector3 rhs)
-{
-    x += rhs.x;
-    y += rhs.y;
-    z += rhs.z;
+    auto m00 = T::splat(m.columns[0].x), m01 = T::splat(m.columns[0].y), m02 = T::splat(m.columns[0].z);
+    auto m10 = T::splat(m.columns[1].x), m11 = T::splat(m.columns[1].y), m12 = T::splat(m.columns[1].z);
+    auto m20 = T::splat(m.columns[2].x), m21 = T::splat(m.columns[2].y), m22 = T::splat(m.columns[2].z);
+    auto m30 = T::splat(m.columns[3].x), m31 = T::splat(m.columns[3].y), m32 = T::splat(m.columns[3].z);
+
+    for (size_t i = begin; i < end; i += width) {
+        auto x = T::load(in.x + i);
+        auto y = T::load(in.y + i);
+        auto z = T::load(in.z + i);
+
+        multiply_add(m00, x, multiply_add(m10, y, multiply_add(m20, z, m30))).store(out.x + i);
+        multiply_add(m01, x, multiply_add(m11, y, multiply_add(m21, z, m31))).store(out.y + i);
+        multiply_add(m02, x, multiply_add(m12, y, multiply_add(m22, z, m32))).store(out.z + i);
+    }
 }
 
-void Vector3::operator-=(Vector3 rhs)
+template<typename T>
+static void transform_boxes(const Matrix4& m, BoxArrays in, BoxArrays out, size_t begin, size_t end)
 {
-    x -= rhs.x;
-    y -= rhs.y;
-    z -= rhs.z;
+    constexpr size_t width = sizeof(T) / sizeof(float);
+
+    auto m00 = T::splat(m.columns[0].x), m01 = T::splat(m.columns[0].y), m02 = T::splat(m.columns[0].z);
+    auto m10 = T::splat(m.columns[1].x), m11 = T::splat(m.columns[1].y), m12 = T::splat(m.columns[1].z);
+    auto m20 = T::splat(m.columns[2].x), m21 = T::splat(m.columns[2].y), m22 = T::splat(m.columns[2].z);
+    auto m30 = T::splat(m.columns[3].x), m31 = T::splat(m.columns[3].y), m32 = T::splat(m.columns[3].z);
+
+    // Extents are transformed by the absolute matrix, which bounds every rotated corner
+    auto a00 = abs(m00), a01 = abs(m01), a02 = abs(m02);
+    auto a10 = abs(m10), a11 = abs(m11), a12 = abs(m12);
+    auto a20 = abs(m20), a21 = abs(m21), a22 = abs(m22);
+    auto half = T::splat(0.5f);
+
+    for (size_t i = begin; i < end; i += width) {
+        auto min_x = T::load(in.min.x + i), max_x = T::load(in.max.x + i);
+        auto min_y = T::load(in.min.y + i), max_y = T::load(in.max.y + i);
+        auto min_z = T::load(in.min.z + i), max_z = T::load(in.max.z + i);
+
+        auto cx = (min_x + max_x) * half, ex = (max_x - min_x) * half;
+        auto cy = (min_y + max_y) * half, ey = (max_y - min_y) * half;
+        auto cz = (min_z + max_z) * half, ez = (max_z - min_z) * half;
+
+        auto center_x = multiply_add(m00, cx, multiply_add(m10, cy, multiply_add(m20, cz, m30)));
+        auto center_y = multiply_add(m01, cx, multiply_add(m11, cy, multiply_add(m21, cz, m31)));
+        auto center_z = multiply_add(m02, cx, multiply_add(m12, cy, multiply_add(m22, cz, m32)));
+
+        auto extent_x = multiply_add(a00, ex, multiply_add(a10, ey, a20 * ez));
+        auto extent_y = multiply_add(a01, ex, multiply_add(a11, ey, a21 * ez));
+        auto extent_z = multiply_add(a02, ex, multiply_add(a12, ey, a22 * ez));
+
+        (center_x - extent_x).store(out.min.x + i);
+        (center_y - extent_y).store(out.min.y + i);
+        (center_z - extent_z).store(out.min.z + i);
+        (center_x + extent_x).store(out.max.x + i);
+        (center_y + extent_y).store(out.max.y + i);
+        (center_z + extent_z).store(out.max.z + i);
+    }
 }
 
-Vector3 Vector3::operator*(float rhs) const
+template<typename T>
+static void box_centers(BoxArrays boxes, PointArrays centers, size_t begin, size_t end)
 {
-    return {x * rhs, y * rhs, z * rhs};
+    constexpr size_t width = sizeof(T) / sizeof(float);
+    auto half = T::splat(0.5f);
+
+    for (size_t i = begin; i < end; i += width) {
+        ((T::load(boxes.min.x + i) + T::load(boxes.max.x + i)) * half).store(centers.x + i);
+        ((T::load(boxes.min.y + i) + T::load(boxes.max.y + i)) * half).store(centers.y + i);
+        ((T::load(boxes.min.z + i) + T::load(boxes.max.z + i)) * half).store(centers.z + i);
+    }
 }
 
-Vector3 Vector3::operator/(float rhs) const
+static size_t full_registers(size_t count)
 {
-    float reciprocal = 1.0f / rhs;
-    return {x * reciprocal, y * reciprocal, z * reciprocal};
+    return count - count % SIMD_WIDTH;
 }
 
-float length(Vector3 lhs)
+void transform_points(const Matrix4& matrix, PointArrays in, PointArrays out, size_t count)
 {
-    return std::sqrt(lhs.x * lhs.x + lhs.y * lhs.y + lhs.z * lhs.z);
+    transform_points<FloatN>(matrix, in, out, 0, full_registers(count));
+    transform_points<Float1>(matrix, in, out, full_registers(count), count);
 }
 
-Vector3 normalize(Vector3 lhs)
+void transform_boxes(const Matrix4& matrix, BoxArrays in, BoxArrays out, size_t count)
 {
-    return lhs / length(lhs);
+    transform_boxes<FloatN>(matrix, in, out, 0, full_registers(count));
+    transform_boxes<Float1>(matrix, in, out, full_registers(count), count);
 }
 
-Vector3 cross(Vector3 lhs, Vector3 rhs)
+void box_centers(BoxArrays boxes, PointArrays centers, size_t count)
 {
-    float x = lhs.y * rhs.z - lhs.z * rhs.y;
-    float y = lhs.z * rhs.x - lhs.x * rhs.z;
-    float z = lhs.x * rhs.y - lhs.y * rhs.x;
-
-    return {x, y, z};
+    box_centers<FloatN>(boxes, centers, 0, full_registers(count));
+    box_centers<Float1>(boxes, centers, full_registers(count), count);
 }
 }
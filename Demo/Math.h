@@ -1,29 +1,37 @@
 #pragma once
 
+#include <Demo/Common/Simd.h>
 #include <Demo/Common/Types.h>
 
+#include <cmath>
+
 namespace Demo {
 constexpr float PI = 3.1415926f;
 
-float radians(float degrees);
+constexpr float radians(float degrees)
+{
+    return degrees / 180.0f * PI;
+}
 
 struct Vector2 {
     float x, y;
 
     Vector2() = default;
-    Vector2(float x, float y)
+    constexpr Vector2(float x, float y)
         : x(x)
         , y(y)
     {
     }
 };
 
+// Three packed floats, as GPU structs expect. Loading them into SIMD registers
+// costs more than the arithmetic, so these stay scalar and inline
 struct Vector3 {
     float x, y, z;
 
     Vector3() = default;
 
-    explicit Vector3(float x)
+    constexpr explicit Vector3(float x)
         : x(x)
         , y(x)
         , z(x)
@@ -37,22 +45,80 @@ struct Vector3 {
     {
     }
 
-    void operator+=(Vector3 rhs);
-    void operator-=(Vector3 rhs);
-    Vector3 operator*(float rhs) const;
-    Vector3 operator/(float rhs) const;
+    constexpr void operator+=(Vector3 rhs)
+    {
+        x += rhs.x;
+        y += rhs.y;
+        z += rhs.z;
+    }
+
+    constexpr void operator-=(Vector3 rhs)
+    {
+        x -= rhs.x;
+        y -= rhs.y;
+        z -= rhs.z;
+    }
+
+    constexpr Vector3 operator+(Vector3 rhs) const { return {x + rhs.x, y + rhs.y, z + rhs.z}; }
+    constexpr Vector3 operator-(Vector3 rhs) const { return {x - rhs.x, y - rhs.y, z - rhs.z}; }
+    constexpr Vector3 operator-() const { return {-x, -y, -z}; }
+    constexpr Vector3 operator*(float rhs) const { return {x * rhs, y * rhs, z * rhs}; }
+    constexpr Vector3 operator*(Vector3 rhs) const { return {x * rhs.x, y * rhs.y, z * rhs.z}; }
+
+    constexpr Vector3 operator/(float rhs) const
+    {
+        float reciprocal = 1.0f / rhs;
+        return {x * reciprocal, y * reciprocal, z * reciprocal};
+    }
+
+    constexpr float operator[](size_t index) const
+    {
+        return index == 0 ? x : index == 1 ? y : z;
+    }
+
     static constexpr Vector3 up() { return {0.0f, 1.0f, 0.0f}; };
 };
 
-float length(Vector3 lhs);
-Vector3 normalize(Vector3 lhs);
-Vector3 cross(Vector3 lhs, Vector3 rhs);
+constexpr float dot(Vector3 lhs, Vector3 rhs)
+{
+    return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+}
+
+constexpr Vector3 cross(Vector3 lhs, Vector3 rhs)
+{
+    float x = lhs.y * rhs.z - lhs.z * rhs.y;
+    float y = lhs.z * rhs.x - lhs.x * rhs.z;
+    float z = lhs.x * rhs.y - lhs.y * rhs.x;
 
+    return {x, y, z};
+}
+
+constexpr Vector3 min(Vector3 lhs, Vector3 rhs)
+{
+    return {rhs.x < lhs.x ? rhs.x : lhs.x, rhs.y < lhs.y ? rhs.y : lhs.y, rhs.z < lhs.z ? rhs.z : lhs.z};
+}
+
+constexpr Vector3 max(Vector3 lhs, Vector3 rhs)
+{
+    return {lhs.x < rhs.x ? rhs.x : lhs.x, lhs.y < rhs.y ? rhs.y : lhs.y, lhs.z < rhs.z ? rhs.z : lhs.z};
+}
+
+inline float length(Vector3 lhs)
+{
+    return std::sqrt(dot(lhs, lhs));
+}
+
+inline Vector3 normalize(Vector3 lhs)
+{
+    return lhs / length(lhs);
+}
+
+// Maps onto one SIMD register, arithmetic goes through Float4
 struct Vector4 {
     float x, y, z, w;
 
     Vector4() = default;
-    Vector4(float x, float y, float z, float w)
+    constexpr Vector4(float x, float y, float z, float w)
         : x(x)
         , y(y)
         , z(z)
@@ -60,15 +126,233 @@ struct Vector4 {
     {
     }
 
-    Vector4(Vector3 xyz, float w)
+    constexpr Vector4(Vector3 xyz, float w)
         : x(xyz.x)
         , y(xyz.y)
         , z(xyz.z)
         , w(w)
     {
     }
+
+    constexpr Vector3 xyz() const { return {x, y, z}; }
+
+    constexpr float operator[](size_t index) const
+    {
+        return index == 0 ? x : index == 1 ? y : index == 2 ? z : w;
+    }
+
+    static Vector4 from(Float4 value)
+    {
+        Vector4 result;
+        value.store(&result.x);
+        return result;
+    }
+
+    Float4 simd() const { return Float4::load(&x); }
 };
 
+static_assert(sizeof(Vector4) == 4 * sizeof(float));
+
+inline Vector4 operator+(Vector4 lhs, Vector4 rhs) { return Vector4::from(lhs.simd() + rhs.simd()); }
+inline Vector4 operator-(Vector4 lhs, Vector4 rhs) { return Vector4::from(lhs.simd() - rhs.simd()); }
+inline Vector4 operator*(Vector4 lhs, Vector4 rhs) { return Vector4::from(lhs.simd() * rhs.simd()); }
+inline Vector4 operator*(Vector4 lhs, float rhs) { return Vector4::from(lhs.simd() * Float4::splat(rhs)); }
+inline Vector4 min(Vector4 lhs, Vector4 rhs) { return Vector4::from(min(lhs.simd(), rhs.simd())); }
+inline Vector4 max(Vector4 lhs, Vector4 rhs) { return Vector4::from(max(lhs.simd(), rhs.simd())); }
+inline float dot(Vector4 lhs, Vector4 rhs) { return (lhs.simd() * rhs.simd()).sum(); }
+inline float length(Vector4 lhs) { return std::sqrt(dot(lhs, lhs)); }
+inline Vector4 normalize(Vector4 lhs) { return lhs * (1.0f / length(lhs)); }
+
+// Unit quaternion, composes as rotations applied right to left like matrices
+struct Quaternion {
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+    float w = 1.0f;
+
+    constexpr Quaternion() = default;
+    constexpr Quaternion(float x, float y, float z, float w)
+        : x(x)
+        , y(y)
+        , z(z)
+        , w(w)
+    {
+    }
+
+    // Counterclockwise rotation in radians around a unit axis
+    static Quaternion axis_angle(Vector3 axis, float angle)
+    {
+        float s = std::sin(angle * 0.5f);
+        return {axis.x * s, axis.y * s, axis.z * s, std::cos(angle * 0.5f)};
+    }
+};
+
+constexpr Quaternion operator*(Quaternion lhs, Quaternion rhs)
+{
+    return {
+        lhs.w * rhs.x + lhs.x * rhs.w + lhs.y * rhs.z - lhs.z * rhs.y,
+        lhs.w * rhs.y - lhs.x * rhs.z + lhs.y * rhs.w + lhs.z * rhs.x,
+        lhs.w * rhs.z + lhs.x * rhs.y - lhs.y * rhs.x + lhs.z * rhs.w,
+        lhs.w * rhs.w - lhs.x * rhs.x - lhs.y * rhs.y - lhs.z * rhs.z,
+    };
+}
+
+constexpr Quaternion conjugate(Quaternion q)
+{
+    return {-q.x, -q.y, -q.z, q.w};
+}
+
+inline Quaternion normalize(Quaternion q)
+{
+    auto unit = normalize(Vector4(q.x, q.y, q.z, q.w));
+    return {unit.x, unit.y, unit.z, unit.w};
+}
+
+constexpr Vector3 rotate(Quaternion q, Vector3 v)
+{
+    Vector3 axis(q.x, q.y, q.z);
+    auto t = cross(axis, v) * 2.0f;
+    return v + t * q.w + cross(axis, t);
+}
+
+// Column major like GLSL, so it can be copied into uniforms as is
+struct Matrix4 {
+    Vector4 columns[4];
+
+    static constexpr Matrix4 identity()
+    {
+        return {{
+            {1.0f, 0.0f, 0.0f, 0.0f},
+            {0.0f, 1.0f, 0.0f, 0.0f},
+            {0.0f, 0.0f, 1.0f, 0.0f},
+            {0.0f, 0.0f, 0.0f, 1.0f},
+        }};
+    }
+
+    static constexpr Matrix4 translation(Vector3 offset)
+    {
+        auto result = identity();
+        result.columns[3] = Vector4(offset, 1.0f);
+        return result;
+    }
+
+    static constexpr Matrix4 scale(Vector3 factors)
+    {
+        return {{
+            {factors.x, 0.0f, 0.0f, 0.0f},
+            {0.0f, factors.y, 0.0f, 0.0f},
+            {0.0f, 0.0f, factors.z, 0.0f},
+            {0.0f, 0.0f, 0.0f, 1.0f},
+        }};
+    }
+
+    static constexpr Matrix4 rotation(Quaternion q)
+    {
+        float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        return {{
+            {1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f},
+            {2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f},
+            {2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f},
+            {0.0f, 0.0f, 0.0f, 1.0f},
+        }};
+    }
+
+    // Right handed view space, looking down -Z
+    static Matrix4 look_at(Vector3 eye, Vector3 target, Vector3 up)
+    {
+        auto f = normalize(target - eye);
+        auto s = normalize(cross(f, up));
+        auto u = cross(s, f);
+
+        return {{
+            {s.x, u.x, -f.x, 0.0f},
+            {s.y, u.y, -f.y, 0.0f},
+            {s.z, u.z, -f.z, 0.0f},
+            {-dot(s, eye), -dot(u, eye), dot(f, eye), 1.0f},
+        }};
+    }
+
+    // Vulkan clip space with depth from 0 at near to 1 at far. Clip space Y
+    // points down in Vulkan, so it's flipped to keep view space Y up
+    static Matrix4 perspective(float fov_y, float aspect_ratio, float near, float far)
+    {
+        float f = 1.0f / std::tan(fov_y * 0.5f);
+
+        return {{
+            {f / aspect_ratio, 0.0f, 0.0f, 0.0f},
+            {0.0f, -f, 0.0f, 0.0f},
+            {0.0f, 0.0f, far / (near - far), -1.0f},
+            {0.0f, 0.0f, near * far / (near - far), 0.0f},
+        }};
+    }
+};
+
+inline Vector4 operator*(const Matrix4& lhs, Vector4 rhs)
+{
+    auto result = lhs.columns[0].simd() * Float4::splat(rhs.x);
+    result = multiply_add(lhs.columns[1].simd(), Float4::splat(rhs.y), result);
+    result = multiply_add(lhs.columns[2].simd(), Float4::splat(rhs.z), result);
+    result = multiply_add(lhs.columns[3].simd(), Float4::splat(rhs.w), result);
+
+    return Vector4::from(result);
+}
+
+inline Matrix4 operator*(const Matrix4& lhs, const Matrix4& rhs)
+{
+    Matrix4 result;
+    for (uint32_t column = 0; column < 4; column++) {
+        result.columns[column] = lhs * rhs.columns[column];
+    }
+
+    return result;
+}
+
+constexpr Matrix4 transpose(const Matrix4& m)
+{
+    return {{
+        {m.columns[0].x, m.columns[1].x, m.columns[2].x, m.columns[3].x},
+        {m.columns[0].y, m.columns[1].y, m.columns[2].y, m.columns[3].y},
+        {m.columns[0].z, m.columns[1].z, m.columns[2].z, m.columns[3].z},
+        {m.columns[0].w, m.columns[1].w, m.columns[2].w, m.columns[3].w},
+    }};
+}
+
+// Ignores the projective row, so only meant for affine matrices
+inline Vector3 transform_point(const Matrix4& m, Vector3 point)
+{
+    return (m * Vector4(point, 1.0f)).xyz();
+}
+
+inline Vector3 transform_direction(const Matrix4& m, Vector3 direction)
+{
+    return (m * Vector4(direction, 0.0f)).xyz();
+}
+
+// Structure of arrays, so batch kernels load SIMD_WIDTH values of one coordinate at once
+struct PointArrays {
+    float* x;
+    float* y;
+    float* z;
+};
+
+struct BoxArrays {
+    PointArrays min;
+    PointArrays max;
+};
+
+// Batch kernels for culling and BVH building. Input and output may be the
+// same arrays, and matrices are treated as affine
+
+void transform_points(const Matrix4& matrix, PointArrays in, PointArrays out, size_t count);
+
+// Axis aligned bounds of the transformed boxes (Arvo, Transforming Axis-Aligned Bounding Boxes)
+void transform_boxes(const Matrix4& matrix, BoxArrays in, BoxArrays out, size_t count);
+
+void box_centers(BoxArrays boxes, PointArrays centers, size_t count);
+
 struct Vector2u {
     uint32_t width;
     uint32_t height;
@@ -1,13 +1,67 @@
+#include <Demo/Common/Log.h>
 #include <Demo/Mesh.h>
+#include <Demo/MeshCache.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
 
 namespace Demo {
-VertexLayout Vertex::layout()
+uint32_t vertex_stride(VertexFormat format)
+{
+    switch (format) {
+    case VertexFormat::Float:
+        return VERTEX_FLOATS * sizeof(float);
+    case VertexFormat::Packed:
+        return 4 * sizeof(uint16_t) + 2 * sizeof(int16_t) + 2 * sizeof(uint16_t);
+    }
+
+    PANIC("Unknown vertex format");
+}
+
+VertexLayout Vertex::layout(VertexFormat format)
 {
+    // Shader inputs stay vec3/vec3/vec2 for both formats, mesh.vert decodes packed data
+    if (format == VertexFormat::Packed) {
+        return VertexLayout{
+            .binding_descriptions = {
+                VkVertexInputBindingDescription{
+                    .binding = 0,
+                    .stride = vertex_stride(format),
+                    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+                },
+            },
+            .attribute_descriptions = {
+                // Three-component 16-bit formats are rarely supported for vertex fetch, so W is padding
+                VkVertexInputAttributeDescription{
+                    .location = 0,
+                    .binding = 0,
+                    .format = VK_FORMAT_R16G16B16A16_UNORM,
+                    .offset = 0,
+                },
+                VkVertexInputAttributeDescription{
+                    .location = 1,
+                    .binding = 0,
+                    .format = VK_FORMAT_R16G16_SNORM,
+                    .offset = 4 * sizeof(uint16_t),
+                },
+                VkVertexInputAttributeDescription{
+                    .location = 2,
+                    .binding = 0,
+                    .format = VK_FORMAT_R16G16_SFLOAT,
+                    .offset = (4 + 2) * sizeof(uint16_t),
+                },
+            },
+        };
+    }
+
     return VertexLayout{
         .binding_descriptions = {
             VkVertexInputBindingDescription{
                 .binding = 0,
-                .stride = 8 * sizeof(float),
+                .stride = vertex_stride(format),
                 .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
             },
         },
@@ -48,12 +102,404 @@ void Mesh::add_vertex(Vertex vertex)
     m_vertex_count++;
 }
 
-GPUMesh::GPUMesh(VmaAllocator allocator, const Mesh& mesh)
+float* Mesh::append_vertices(uint32_t count)
+{
+    auto offset = m_data.size();
+    m_data.resize(offset + static_cast<size_t>(count) * VERTEX_FLOATS);
+    m_vertex_count += count;
+
+    return m_data.data() + offset;
+}
+
+uint32_t* Mesh::append_indices(size_t count)
+{
+    auto offset = m_indices.size();
+    m_indices.resize(offset + count);
+
+    return m_indices.data() + offset;
+}
+
+MeshBounds Mesh::bounds() const
+{
+    MeshBounds bounds = {};
+    if (m_vertex_count == 0) {
+        return bounds;
+    }
+
+    bounds.min = Vector3(m_data[0], m_data[1], m_data[2]);
+    bounds.max = bounds.min;
+    for (uint32_t vertex = 1; vertex < m_vertex_count; vertex++) {
+        const float* data = &m_data[vertex * VERTEX_FLOATS];
+        bounds.min = min(bounds.min, Vector3(data[0], data[1], data[2]));
+        bounds.max = max(bounds.max, Vector3(data[0], data[1], data[2]));
+    }
+
+    return bounds;
+}
+
+static uint16_t quantize_unorm16(float value)
+{
+    return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+}
+
+static int16_t quantize_snorm16(float value)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+// IEEE 754 binary16 with round to nearest even
+static uint16_t float_to_half(float value)
+{
+    uint32_t bits = 0;
+    memcpy(&bits, &value, sizeof(value));
+
+    auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+    auto exponent = static_cast<int32_t>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (((bits >> 23) & 0xff) == 0xff) {
+        return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+    }
+
+    if (exponent >= 31) {
+        return sign | 0x7c00;
+    }
+
+    // Too small for a normal half, so shift the implicit bit into a subnormal
+    uint32_t shift = 13;
+    uint32_t half = 0;
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        shift = 14 - exponent;
+    } else {
+        half = static_cast<uint32_t>(exponent) << 10;
+    }
+
+    half |= mantissa >> shift;
+    uint32_t remainder = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+
+    // A carry out of the mantissa correctly bumps the exponent
+    if (remainder > halfway || (remainder == halfway && (half & 1))) {
+        half++;
+    }
+
+    return static_cast<uint16_t>(sign | half);
+}
+
+// Cigolle et al., A Survey of Efficient Representations for Independent Unit Vectors
+static Vector2 encode_octahedral(Vector3 normal)
+{
+    float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 == 0.0f) {
+        return {0.0f, 0.0f};
+    }
+
+    float x = normal.x / l1;
+    float y = normal.y / l1;
+
+    // Lower hemisphere folds over the diagonals
+    if (normal.z < 0.0f) {
+        float folded_x = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        float folded_y = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+        x = folded_x;
+        y = folded_y;
+    }
+
+    return {x, y};
+}
+
+std::vector<uint8_t> Mesh::encode(VertexFormat format) const
+{
+    auto stride = vertex_stride(format);
+    std::vector<uint8_t> bytes(m_vertex_count * stride);
+
+    if (format == VertexFormat::Float) {
+        memcpy(bytes.data(), m_data.data(), bytes.size());
+        return bytes;
+    }
+
+    auto box = bounds();
+    auto extent = box.max - box.min;
+
+    // Flat axes have nothing to quantize
+    auto scale = [](float extent) { return extent > 0.0f ? 1.0f / extent : 0.0f; };
+    Vector3 inverse_extent(scale(extent.x), scale(extent.y), scale(extent.z));
+
+    for (uint32_t vertex = 0; vertex < m_vertex_count; vertex++) {
+        const float* data = &m_data[vertex * VERTEX_FLOATS];
+        auto normal = encode_octahedral(Vector3(data[3], data[4], data[5]));
+
+        std::array<uint16_t, 8> packed = {
+            quantize_unorm16((data[0] - box.min.x) * inverse_extent.x),
+            quantize_unorm16((data[1] - box.min.y) * inverse_extent.y),
+            quantize_unorm16((data[2] - box.min.z) * inverse_extent.z),
+            0,
+            static_cast<uint16_t>(quantize_snorm16(normal.x)),
+            static_cast<uint16_t>(quantize_snorm16(normal.y)),
+            float_to_half(data[6]),
+            float_to_half(data[7]),
+        };
+
+        static_assert(sizeof(packed) == 16);
+        memcpy(&bytes[vertex * stride], packed.data(), sizeof(packed));
+    }
+
+    return bytes;
+}
+
+// Post-transform cache size assumed by the triangle reordering. Tipsify is
+// not very sensitive to it, and most GPUs behave like a FIFO of this size
+constexpr uint32_t VERTEX_CACHE_SIZE = 16;
+
+struct VertexKey {
+    std::array<uint32_t, VERTEX_FLOATS> bits;
+
+    bool operator==(const VertexKey& other) const { return bits == other.bits; }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& key) const
+    {
+        // FNV-1a over the raw bits
+        uint64_t hash = 14695981039346656037ull;
+        for (auto bits : key.bits) {
+            hash = (hash ^ bits) * 1099511628211ull;
+        }
+
+        return hash;
+    }
+};
+
+static VertexKey vertex_key(const float* vertex)
 {
+    VertexKey key = {};
+
+    for (uint32_t i = 0; i < VERTEX_FLOATS; i++) {
+        // Negative zero must weld with positive zero
+        float value = vertex[i] == 0.0f ? 0.0f : vertex[i];
+        memcpy(&key.bits[i], &value, sizeof(value));
+    }
+
+    return key;
+}
+
+// Sander, Nehab, Barczak, Fast Triangle Reordering for Vertex Locality and Reduced Overdraw
+static std::vector<uint32_t> tipsify(const std::vector<uint32_t>& indices, uint32_t vertex_count)
+{
+    auto triangle_count = static_cast<uint32_t>(indices.size() / 3);
+
+    // Triangles adjacent to each vertex, stored as one array with per-vertex offsets
+    std::vector<uint32_t> live(vertex_count, 0);
+    for (auto index : indices) {
+        live[index]++;
+    }
+
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (uint32_t vertex = 0; vertex < vertex_count; vertex++) {
+        offsets[vertex + 1] = offsets[vertex] + live[vertex];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill = offsets;
+    for (uint32_t triangle = 0; triangle < triangle_count; triangle++) {
+        for (uint32_t corner = 0; corner < 3; corner++) {
+            adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    std::vector<uint32_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+
+    uint32_t time = VERTEX_CACHE_SIZE + 1;
+    uint32_t cursor = 0;
+    int64_t fanning = vertex_count > 0 ? 0 : -1;
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        for (auto i = offsets[fanning]; i < offsets[fanning + 1]; i++) {
+            auto triangle = adjacency[i];
+            if (emitted[triangle]) {
+                continue;
+            }
+
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                auto vertex = indices[triangle * 3 + corner];
+
+                result.push_back(vertex);
+                dead_end.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+
+                if (time - cache_time[vertex] > VERTEX_CACHE_SIZE) {
+                    cache_time[vertex] = time++;
+                }
+            }
+
+            emitted[triangle] = true;
+        }
+
+        // Prefer a vertex which is still in cache and stays there while its remaining triangles are emitted,
+        // any live candidate beats none (Sander et al. start from -1)
+        fanning = -1;
+        int64_t best_priority = -1;
+        for (auto vertex : candidates) {
+            if (live[vertex] == 0) {
+                continue;
+            }
+
+            int64_t priority = 0;
+            if (time - cache_time[vertex] + 2 * live[vertex] <= VERTEX_CACHE_SIZE) {
+                priority = time - cache_time[vertex];
+            }
+
+            if (priority > best_priority) {
+                best_priority = priority;
+                fanning = vertex;
+            }
+        }
+
+        // Dead end, so continue from a recently used vertex or any vertex with triangles left
+        while (fanning < 0 && !dead_end.empty()) {
+            auto vertex = dead_end.back();
+            dead_end.pop_back();
+
+            if (live[vertex] > 0) {
+                fanning = vertex;
+            }
+        }
+
+        while (fanning < 0 && cursor < vertex_count) {
+            if (live[cursor] > 0) {
+                fanning = cursor;
+            }
+
+            cursor++;
+        }
+    }
+
+    return result;
+}
+
+void Mesh::build_indexed()
+{
+    ASSERT(!indexed(), "Mesh is already indexed");
+
+    std::unordered_map<VertexKey, uint32_t, VertexKeyHash> unique_vertices;
+    unique_vertices.reserve(m_vertex_count);
+
+    std::vector<float> welded;
+    std::vector<uint32_t> indices;
+    indices.reserve(m_vertex_count);
+
+    for (uint32_t vertex = 0; vertex < m_vertex_count; vertex++) {
+        const float* data = &m_data[vertex * VERTEX_FLOATS];
+        auto welded_count = static_cast<uint32_t>(unique_vertices.size());
+        auto [it, inserted] = unique_vertices.try_emplace(vertex_key(data), welded_count);
+
+        if (inserted) {
+            welded.insert(welded.end(), data, data + VERTEX_FLOATS);
+        }
+
+        indices.push_back(it->second);
+    }
+
+    auto welded_count = static_cast<uint32_t>(unique_vertices.size());
+    indices = tipsify(indices, welded_count);
+
+    // Number vertices in order of first use, so that vertex fetch walks memory linearly
+    constexpr uint32_t UNASSIGNED = ~0u;
+    std::vector<uint32_t> remap(welded_count, UNASSIGNED);
+    uint32_t next_vertex = 0;
+
+    m_data.resize(welded.size());
+    for (auto& index : indices) {
+        if (remap[index] == UNASSIGNED) {
+            memcpy(&m_data[next_vertex * VERTEX_FLOATS], &welded[index * VERTEX_FLOATS], VERTEX_FLOATS * sizeof(float));
+            remap[index] = next_vertex++;
+        }
+
+        index = remap[index];
+    }
+
+    debug("Indexed mesh: {} vertices welded into {}", m_vertex_count, welded_count);
+
+    m_indices = move(indices);
+    m_vertex_count = welded_count;
+}
+
+GPUMesh::GPUMesh(VmaAllocator allocator, Uploader& uploader, const Mesh& mesh, VertexFormat format)
+{
+    auto vertices = mesh.encode(format);
+
     m_vertex_count = mesh.vertex_count();
-    m_buffer = Buffer(allocator, mesh.data().size() * sizeof(float), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-    m_buffer.map([&](auto* ptr) {
-        memcpy(ptr, mesh.data().data(), mesh.data().size() * sizeof(float));
-    });
+    m_index_count = mesh.index_count();
+    m_format = format;
+    m_bounds = mesh.bounds();
+
+    upload(allocator, uploader, vertices.data(), vertices.size(), mesh.indices().data(), mesh.indices().size());
+}
+
+GPUMesh::GPUMesh(VmaAllocator allocator, Uploader& uploader, const MeshCache& cache)
+{
+    ASSERT(cache.is_valid(), "Mesh cache is not valid");
+
+    m_vertex_count = cache.vertex_count();
+    m_index_count = cache.index_count();
+    m_format = cache.format();
+    m_bounds = cache.bounds();
+
+    // Staging copies straight out of the mapping, pages are read in as the copy reaches them
+    upload(allocator, uploader, cache.vertex_data(), cache.vertex_data_size(), cache.indices(), cache.index_count());
+}
+
+void GPUMesh::upload(VmaAllocator allocator, Uploader& uploader, const void* vertices, size_t vertex_size, const uint32_t* indices, size_t index_count)
+{
+    m_buffer = Buffer(
+        allocator,
+        vertex_size,
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VMA_MEMORY_USAGE_GPU_ONLY,
+        BufferFlags::None,
+        uploader.queue_families());
+
+    m_upload_ticket = uploader.upload(m_buffer, vertices, vertex_size);
+
+    if (index_count > 0) {
+        auto index_size = index_count * sizeof(uint32_t);
+
+        m_index_buffer = Buffer(
+            allocator,
+            index_size,
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VMA_MEMORY_USAGE_GPU_ONLY,
+            BufferFlags::None,
+            uploader.queue_families());
+
+        m_upload_ticket = uploader.upload(m_index_buffer, indices, index_size);
+    }
+}
+
+void GPUMesh::draw(VkCommandBuffer cmd) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, m_buffer.as_ptr(), &offset);
+
+    if (m_index_buffer.raw()) {
+        vkCmdBindIndexBuffer(cmd, m_index_buffer.raw(), 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(cmd, m_index_count, 1, 0, 0, 0);
+    } else {
+        vkCmdDraw(cmd, m_vertex_count, 1, 0, 0);
+    }
 }
 }
@@ -3,6 +3,7 @@
 #include <Demo/Buffer.h>
 #include <Demo/RendererBase.h>
 #include <Demo/Math.h>
+#include <Demo/Uploader.h>
 #include <vk_mem_alloc.h>
 
 #include <vector>
@@ -13,35 +14,102 @@ struct VertexLayout {
     std::vector<VkVertexInputAttributeDescription> attribute_descriptions;
 };
 
+// Position, normal and UV
+constexpr uint32_t VERTEX_FLOATS = 8;
+
+enum class VertexFormat {
+    // 32 bytes, everything as 32-bit floats
+    Float,
+    // 16 bytes, 16-bit positions relative to the mesh bounds, octahedral normals and half-float UVs
+    Packed,
+};
+
+uint32_t vertex_stride(VertexFormat format);
+
 struct Vertex {
     Vector3 position;
     Vector3 normal;
     Vector2 uv;
 
-    static VertexLayout layout();
+    static VertexLayout layout(VertexFormat format = VertexFormat::Float);
+};
+
+// Pushed to mesh.vert, which maps packed positions back into this box
+struct MeshBounds {
+    Vector3 min = Vector3(0.0f);
+    float padding = 0.0f;
+    Vector3 max = Vector3(0.0f);
 };
 
 class Mesh {
 public:
     Mesh() = default;
     void add_vertex(Vertex vertex);
+
+    // Appends zeroed vertices and returns their floats, so importers can fill
+    // disjoint ranges from several threads without going through add_vertex()
+    float* append_vertices(uint32_t count);
+
+    // Same for indices, which must eventually cover every vertex of the mesh.
+    // build_indexed() can't be used once the mesh has indices
+    uint32_t* append_indices(size_t count);
     const std::vector<float>& data() const { return m_data; }
     uint32_t vertex_count() const { return m_vertex_count; }
 
+    // Welds duplicate vertices, then reorders triangles for the post-transform
+    // vertex cache and vertices for fetch locality. Triangles added so far
+    // become indexed, so add_vertex() can't be used afterwards
+    void build_indexed();
+
+    bool indexed() const { return !m_indices.empty(); }
+    const std::vector<uint32_t>& indices() const { return m_indices; }
+
+    // Number of vertices to draw, which differs from vertex_count() once indexed
+    uint32_t index_count() const { return indexed() ? static_cast<uint32_t>(m_indices.size()) : m_vertex_count; }
+
+    MeshBounds bounds() const;
+
+    // Vertex data as laid out by Vertex::layout(format)
+    std::vector<uint8_t> encode(VertexFormat format) const;
+
 private:
     uint32_t m_vertex_count = 0;
     std::vector<float> m_data;
+    std::vector<uint32_t> m_indices;
 };
 
+class MeshCache;
+
+// Vertex data lives in device local memory and is filled by the uploader
 class GPUMesh {
 public:
     GPUMesh() = default;
-    GPUMesh(VmaAllocator allocator, const Mesh& mesh);
+    GPUMesh(VmaAllocator allocator, Uploader& uploader, const Mesh& mesh, VertexFormat format = VertexFormat::Float);
+    GPUMesh(VmaAllocator allocator, Uploader& uploader, const MeshCache& cache);
     uint32_t vertex_count() const { return m_vertex_count; }
+    uint32_t index_count() const { return m_index_count; }
+    VertexFormat format() const { return m_format; }
+    const MeshBounds& bounds() const { return m_bounds; }
     const Buffer& buffer() const { return m_buffer; }
 
+    // Empty unless the mesh was indexed
+    const Buffer& index_buffer() const { return m_index_buffer; }
+
+    // Binds vertex and index buffers and draws the whole mesh
+    void draw(VkCommandBuffer cmd) const;
+
+    // Mesh must not be drawn before the uploader completes this ticket
+    UploadTicket upload_ticket() const { return m_upload_ticket; }
+
 private:
+    void upload(VmaAllocator allocator, Uploader& uploader, const void* vertices, size_t vertex_size, const uint32_t* indices, size_t index_count);
+
     uint32_t m_vertex_count = 0;
+    uint32_t m_index_count = 0;
+    VertexFormat m_format = VertexFormat::Float;
+    MeshBounds m_bounds = {};
     Buffer m_buffer = {};
+    Buffer m_index_buffer = {};
+    UploadTicket m_upload_ticket = 0;
 };
 }
@@ -0,0 +1,199 @@
+#include <Demo/Common/AtomicFile.h>
+#include <Demo/Common/Log.h>
+#include <Demo/MeshCache.h>
+
+#include <cstring>
+#include <filesystem>
+#include <span>
+#include <system_error>
+
+namespace Demo {
+constexpr uint32_t MESH_CACHE_MAGIC = 0x48534d44; // "DMSH"
+
+// Bump whenever the header or the layout of a vertex format changes
+constexpr uint32_t MESH_CACHE_VERSION = 1;
+
+// Streams start on this boundary, which suits vertex fetch and keeps indices aligned in the mapping
+constexpr uint64_t MESH_CACHE_ALIGNMENT = 16;
+
+// Little endian, as are all the platforms the demo runs on
+struct MeshCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_format;
+    uint32_t vertex_stride;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint64_t source_size;
+    int64_t source_modified;
+    // Hash of both streams, only checked by debug builds
+    uint64_t content_hash;
+    float bounds_min[3];
+    float bounds_max[3];
+    uint64_t vertex_offset;
+    uint64_t index_offset;
+    uint32_t reserved[2];
+};
+
+static_assert(sizeof(MeshCacheHeader) == 96);
+
+static uint64_t align_up(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// FNV-1a over 64-bit words, fast enough to not dominate a warm start
+static uint64_t hash_bytes(const uint8_t* data, size_t size, uint64_t hash = 14695981039346656037ull)
+{
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+
+    for (; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+
+    return hash;
+}
+
+MeshSource mesh_source(const char* path)
+{
+    std::error_code error;
+    auto size = std::filesystem::file_size(path, error);
+    if (error) {
+        return {};
+    }
+
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return {};
+    }
+
+    return MeshSource{
+        .size = size,
+        .modified = static_cast<int64_t>(modified.time_since_epoch().count()),
+    };
+}
+
+void write_mesh_cache(const std::string& path, const Mesh& mesh, VertexFormat format, MeshSource source)
+{
+    auto vertices = mesh.encode(format);
+
+    // Non-indexed meshes get an identity index stream, so loading never has to branch
+    std::vector<uint32_t> indices = mesh.indices();
+    if (!mesh.indexed()) {
+        indices.resize(mesh.vertex_count());
+        for (uint32_t i = 0; i < indices.size(); i++) {
+            indices[i] = i;
+        }
+    }
+
+    auto index_size = indices.size() * sizeof(uint32_t);
+    auto bounds = mesh.bounds();
+
+    MeshCacheHeader header = {
+        .magic = MESH_CACHE_MAGIC,
+        .version = MESH_CACHE_VERSION,
+        .vertex_format = static_cast<uint32_t>(format),
+        .vertex_stride = vertex_stride(format),
+        .vertex_count = mesh.vertex_count(),
+        .index_count = static_cast<uint32_t>(indices.size()),
+        .source_size = source.size,
+        .source_modified = source.modified,
+        .content_hash = hash_bytes(reinterpret_cast<const uint8_t*>(indices.data()), index_size, hash_bytes(vertices.data(), vertices.size())),
+        .bounds_min = {bounds.min.x, bounds.min.y, bounds.min.z},
+        .bounds_max = {bounds.max.x, bounds.max.y, bounds.max.z},
+        .vertex_offset = align_up(sizeof(MeshCacheHeader), MESH_CACHE_ALIGNMENT),
+        .index_offset = align_up(sizeof(MeshCacheHeader) + vertices.size(), MESH_CACHE_ALIGNMENT),
+    };
+
+    uint8_t padding[MESH_CACHE_ALIGNMENT] = {};
+    auto vertex_padding = std::span(padding, header.vertex_offset - sizeof(header));
+    auto index_padding = std::span(padding, header.index_offset - header.vertex_offset - vertices.size());
+
+    bool written = write_file_atomically(path,
+        {
+            std::span(reinterpret_cast<const uint8_t*>(&header), sizeof(header)),
+            vertex_padding,
+            vertices,
+            index_padding,
+            std::span(reinterpret_cast<const uint8_t*>(indices.data()), index_size),
+        });
+
+    if (!written) {
+        return;
+    }
+
+    debug("Saved mesh cache {} with {} vertices", path, mesh.vertex_count());
+}
+
+MeshCache::MeshCache(const char* path)
+{
+    m_file = MappedFile(path);
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    MeshCacheHeader header = {};
+    if (m_file.size() < sizeof(header)) {
+        warning("Mesh cache {} is truncated", path);
+        return;
+    }
+
+    memcpy(&header, m_file.data(), sizeof(header));
+
+    if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION) {
+        warning("Mesh cache {} was written by another version", path);
+        return;
+    }
+
+    auto format = static_cast<VertexFormat>(header.vertex_format);
+    bool known_format = format == VertexFormat::Float || format == VertexFormat::Packed;
+    auto vertex_size = static_cast<uint64_t>(header.vertex_count) * header.vertex_stride;
+    auto index_size = static_cast<uint64_t>(header.index_count) * sizeof(uint32_t);
+
+    bool consistent = known_format
+        && header.vertex_stride == vertex_stride(format)
+        && header.vertex_offset % MESH_CACHE_ALIGNMENT == 0
+        && header.index_offset % MESH_CACHE_ALIGNMENT == 0
+        && header.vertex_offset >= sizeof(header)
+        && header.vertex_offset + vertex_size <= header.index_offset
+        && header.index_offset + index_size <= m_file.size();
+
+    if (!consistent) {
+        warning("Mesh cache {} is corrupted", path);
+        return;
+    }
+
+    m_source = {
+        .size = header.source_size,
+        .modified = header.source_modified,
+    };
+    m_format = format;
+    m_vertex_count = header.vertex_count;
+    m_index_count = header.index_count;
+    m_bounds.min = Vector3(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+    m_bounds.max = Vector3(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+    m_vertex_data = m_file.data() + header.vertex_offset;
+    m_indices = reinterpret_cast<const uint32_t*>(m_file.data() + header.index_offset);
+
+    // Hashing touches every page, which release builds leave to the upload
+    DEBUG_ASSERT(hash_bytes(reinterpret_cast<const uint8_t*>(m_indices), index_size, hash_bytes(m_vertex_data, vertex_size)) == header.content_hash, "Mesh cache content doesn't match its hash");
+
+    m_valid = true;
+}
+
+Mesh MeshCache::to_mesh() const
+{
+    ASSERT(m_valid && m_format == VertexFormat::Float, "Only valid float caches can be turned back into a Mesh");
+
+    Mesh mesh;
+    memcpy(mesh.append_vertices(m_vertex_count), m_vertex_data, vertex_data_size());
+    memcpy(mesh.append_indices(m_index_count), m_indices, m_index_count * sizeof(uint32_t));
+
+    return mesh;
+}
+}
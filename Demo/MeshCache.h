@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Demo/Common/MappedFile.h>
+#include <Demo/Mesh.h>
+
+#include <string>
+
+namespace Demo {
+// Identifies the asset a cache was built from without reading it
+struct MeshSource {
+    uint64_t size = 0;
+    int64_t modified = 0;
+
+    bool operator==(const MeshSource& other) const = default;
+};
+
+// Zero if the file doesn't exist
+MeshSource mesh_source(const char* path);
+
+// Writes vertex and index streams exactly as GPUMesh uploads them, replacing the file atomically
+void write_mesh_cache(const std::string& path, const Mesh& mesh, VertexFormat format, MeshSource source);
+
+// Mapped cache file, its streams are handed to the uploader without intermediate copies
+class MeshCache : public NonCopyable {
+public:
+    MeshCache() = default;
+
+    // Invalid if the file is missing, truncated or was written by another version
+    explicit MeshCache(const char* path);
+
+    bool is_valid() const { return m_valid; }
+    MeshSource source() const { return m_source; }
+    VertexFormat format() const { return m_format; }
+    uint32_t vertex_count() const { return m_vertex_count; }
+    uint32_t index_count() const { return m_index_count; }
+    const MeshBounds& bounds() const { return m_bounds; }
+
+    const uint8_t* vertex_data() const { return m_vertex_data; }
+    size_t vertex_data_size() const { return static_cast<size_t>(m_vertex_count) * vertex_stride(m_format); }
+    const uint32_t* indices() const { return m_indices; }
+
+    // Copies the streams back into a Mesh, only float vertices can be restored exactly
+    Mesh to_mesh() const;
+
+    MeshCache(MeshCache&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    MeshCache& operator=(MeshCache&& other) noexcept
+    {
+        swap(m_file, other.m_file);
+        swap(m_valid, other.m_valid);
+        swap(m_source, other.m_source);
+        swap(m_format, other.m_format);
+        swap(m_vertex_count, other.m_vertex_count);
+        swap(m_index_count, other.m_index_count);
+        swap(m_bounds, other.m_bounds);
+        swap(m_vertex_data, other.m_vertex_data);
+        swap(m_indices, other.m_indices);
+
+        return *this;
+    }
+
+private:
+    MappedFile m_file;
+    bool m_valid = false;
+    MeshSource m_source = {};
+    VertexFormat m_format = VertexFormat::Float;
+    uint32_t m_vertex_count = 0;
+    uint32_t m_index_count = 0;
+    MeshBounds m_bounds = {};
+    const uint8_t* m_vertex_data = nullptr;
+    const uint32_t* m_indices = nullptr;
+};
+}
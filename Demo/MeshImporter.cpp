@@ -0,0 +1,792 @@
+#include <Demo/Common/Jobs.h>
+#include <Demo/Common/Log.h>
+#include <Demo/MeshImporter.h>
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Demo {
+// Large enough to amortize scheduling, small enough to balance uneven files across threads
+constexpr size_t MIN_CHUNK_SIZE = 1024 * 1024;
+constexpr uint32_t CHUNKS_PER_THREAD = 4;
+
+// Vertices or indices converted by a single glTF task
+constexpr uint32_t GLB_TASK_SIZE = 64 * 1024;
+
+constexpr uint32_t MAX_JSON_DEPTH = 64;
+
+static void write_vertex(float* out, Vector3 position, Vector3 normal, Vector2 uv)
+{
+    float vertex[VERTEX_FLOATS] = {position.x, position.y, position.z, normal.x, normal.y, normal.z, uv.x, uv.y};
+    memcpy(out, vertex, sizeof(vertex));
+}
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static std::string_view skip_spaces(std::string_view text)
+{
+    size_t i = 0;
+    while (i < text.size() && is_space(text[i])) {
+        i++;
+    }
+
+    return text.substr(i);
+}
+
+static std::string_view next_token(std::string_view& text)
+{
+    text = skip_spaces(text);
+
+    size_t end = 0;
+    while (end < text.size() && !is_space(text[end])) {
+        end++;
+    }
+
+    auto token = text.substr(0, end);
+    text.remove_prefix(end);
+
+    return token;
+}
+
+template<typename F>
+static void for_each_line(std::string_view text, const F& f)
+{
+    while (!text.empty()) {
+        auto end = text.find('\n');
+        f(text.substr(0, end));
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+    }
+}
+
+// Splits text into pieces which end at line boundaries
+static std::vector<std::string_view> split_lines(std::string_view text)
+{
+    auto count = std::max<size_t>(1, std::min<size_t>(thread_count() * CHUNKS_PER_THREAD, text.size() / MIN_CHUNK_SIZE));
+
+    std::vector<std::string_view> chunks;
+    size_t begin = 0;
+    for (size_t i = 1; i <= count && begin < text.size(); i++) {
+        auto end = i == count ? text.size() : std::max(begin, text.size() * i / count);
+        end = std::min(text.find('\n', end), text.size() - 1) + 1;
+
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+
+    return chunks;
+}
+
+enum class ObjLine {
+    Other,
+    Position,
+    Normal,
+    UV,
+    Face,
+};
+
+// Consumes the keyword, leaving the arguments in line
+static ObjLine classify(std::string_view& line)
+{
+    auto keyword = next_token(line);
+
+    if (keyword == "v")
+        return ObjLine::Position;
+    if (keyword == "vn")
+        return ObjLine::Normal;
+    if (keyword == "vt")
+        return ObjLine::UV;
+    if (keyword == "f")
+        return ObjLine::Face;
+
+    return ObjLine::Other;
+}
+
+static float parse_float(std::string_view& text)
+{
+    text = skip_spaces(text);
+
+    float value = 0.0f;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    ASSERT(error == std::errc(), "Malformed number in OBJ file");
+    text.remove_prefix(end - text.data());
+
+    return value;
+}
+
+struct ObjCounts {
+    uint32_t positions = 0;
+    uint32_t normals = 0;
+    uint32_t uvs = 0;
+    uint32_t triangles = 0;
+};
+
+struct ObjChunk {
+    std::string_view text;
+    // Totals of this chunk, then of all chunks before it
+    ObjCounts counts;
+    ObjCounts first;
+};
+
+// OBJ indices start at 1, so 0 means the attribute is missing
+struct ObjCorner {
+    int32_t position = 0;
+    int32_t uv = 0;
+    int32_t normal = 0;
+};
+
+static ObjCorner parse_corner(std::string_view token)
+{
+    ObjCorner corner = {};
+    int32_t* fields[] = {&corner.position, &corner.uv, &corner.normal};
+
+    for (auto* field : fields) {
+        auto slash = token.find('/');
+        auto part = token.substr(0, slash);
+
+        if (!part.empty()) {
+            auto [end, error] = std::from_chars(part.data(), part.data() + part.size(), *field);
+            ASSERT(error == std::errc() && end == part.data() + part.size(), "Malformed face in OBJ file");
+        }
+
+        if (slash == std::string_view::npos) {
+            break;
+        }
+
+        token.remove_prefix(slash + 1);
+    }
+
+    ASSERT(corner.position != 0, "OBJ face corner has no position");
+
+    return corner;
+}
+
+// Negative indices count back from the last element defined before the face
+static uint32_t resolve_index(int32_t index, uint32_t defined, uint32_t total)
+{
+    int64_t resolved = index > 0 ? static_cast<int64_t>(index) - 1 : static_cast<int64_t>(defined) + index;
+    ASSERT(resolved >= 0 && resolved < total, "OBJ index is out of range");
+
+    return static_cast<uint32_t>(resolved);
+}
+
+Mesh import_obj(const MappedFile& file)
+{
+    std::vector<ObjChunk> chunks;
+    for (auto text : split_lines(file.text())) {
+        chunks.push_back({.text = text});
+    }
+
+    auto chunk_count = static_cast<uint32_t>(chunks.size());
+
+    // Counting first lets every chunk write straight to its final place
+    parallel_for(chunk_count, [&](uint32_t i) {
+        auto& counts = chunks[i].counts;
+
+        for_each_line(chunks[i].text, [&](std::string_view line) {
+            switch (classify(line)) {
+            case ObjLine::Position:
+                counts.positions++;
+                break;
+            case ObjLine::Normal:
+                counts.normals++;
+                break;
+            case ObjLine::UV:
+                counts.uvs++;
+                break;
+            case ObjLine::Face: {
+                uint32_t corners = 0;
+                while (!next_token(line).empty()) {
+                    corners++;
+                }
+
+                if (corners >= 3) {
+                    counts.triangles += corners - 2;
+                }
+                break;
+            }
+            case ObjLine::Other:
+                break;
+            }
+        });
+    });
+
+    ObjCounts total = {};
+    for (auto& chunk : chunks) {
+        chunk.first = total;
+        total.positions += chunk.counts.positions;
+        total.normals += chunk.counts.normals;
+        total.uvs += chunk.counts.uvs;
+        total.triangles += chunk.counts.triangles;
+    }
+
+    std::vector<Vector3> positions(total.positions);
+    std::vector<Vector3> normals(total.normals);
+    std::vector<Vector2> uvs(total.uvs);
+
+    parallel_for(chunk_count, [&](uint32_t i) {
+        auto next = chunks[i].first;
+
+        for_each_line(chunks[i].text, [&](std::string_view line) {
+            switch (classify(line)) {
+            case ObjLine::Position: {
+                float x = parse_float(line);
+                float y = parse_float(line);
+                float z = parse_float(line);
+                positions[next.positions++] = Vector3(x, y, z);
+                break;
+            }
+            case ObjLine::Normal: {
+                float x = parse_float(line);
+                float y = parse_float(line);
+                float z = parse_float(line);
+                normals[next.normals++] = Vector3(x, y, z);
+                break;
+            }
+            case ObjLine::UV: {
+                float u = parse_float(line);
+                // V is optional for 1D textures
+                float v = skip_spaces(line).empty() ? 0.0f : parse_float(line);
+                uvs[next.uvs++] = Vector2(u, v);
+                break;
+            }
+            case ObjLine::Face:
+            case ObjLine::Other:
+                break;
+            }
+        });
+    });
+
+    Mesh mesh;
+    float* vertices = mesh.append_vertices(total.triangles * 3);
+
+    parallel_for(chunk_count, [&](uint32_t i) {
+        auto defined = chunks[i].first;
+        auto triangle = chunks[i].first.triangles;
+        std::vector<ObjCorner> corners;
+
+        for_each_line(chunks[i].text, [&](std::string_view line) {
+            switch (classify(line)) {
+            case ObjLine::Position:
+                defined.positions++;
+                return;
+            case ObjLine::Normal:
+                defined.normals++;
+                return;
+            case ObjLine::UV:
+                defined.uvs++;
+                return;
+            case ObjLine::Face:
+                break;
+            case ObjLine::Other:
+                return;
+            }
+
+            corners.clear();
+            for (auto token = next_token(line); !token.empty(); token = next_token(line)) {
+                corners.push_back(parse_corner(token));
+            }
+
+            for (size_t corner = 2; corner < corners.size(); corner++) {
+                ObjCorner fan[] = {corners[0], corners[corner - 1], corners[corner]};
+                Vector3 p[3];
+                for (uint32_t j = 0; j < 3; j++) {
+                    p[j] = positions[resolve_index(fan[j].position, defined.positions, total.positions)];
+                }
+
+                auto face_normal = normalize(cross(p[1] - p[0], p[2] - p[0]));
+
+                for (uint32_t j = 0; j < 3; j++) {
+                    auto normal = fan[j].normal ? normals[resolve_index(fan[j].normal, defined.normals, total.normals)] : face_normal;
+                    auto uv = fan[j].uv ? uvs[resolve_index(fan[j].uv, defined.uvs, total.uvs)] : Vector2(0.0f, 0.0f);
+
+                    write_vertex(&vertices[(triangle * 3 + j) * VERTEX_FLOATS], p[j], normal, uv);
+                }
+
+                triangle++;
+            }
+        });
+    });
+
+    return mesh;
+}
+
+struct JsonValue {
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0.0;
+    // Raw text between the quotes, escapes are kept since glTF keys never use them
+    std::string_view string;
+    std::vector<JsonValue> array;
+    std::vector<std::pair<std::string_view, JsonValue>> object;
+
+    const JsonValue* find(std::string_view key) const
+    {
+        for (auto& [name, value] : object) {
+            if (name == key) {
+                return &value;
+            }
+        }
+
+        return nullptr;
+    }
+
+    uint32_t get_uint(std::string_view key, uint32_t fallback) const
+    {
+        auto* value = find(key);
+        return value && value->type == Type::Number ? static_cast<uint32_t>(value->number) : fallback;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text)
+        : m_text(text)
+    {
+    }
+
+    JsonValue parse()
+    {
+        auto value = parse_value(0);
+        skip_whitespace();
+        ASSERT(m_position == m_text.size(), "Trailing data after JSON");
+
+        return value;
+    }
+
+private:
+    void skip_whitespace()
+    {
+        while (m_position < m_text.size() && (m_text[m_position] == ' ' || m_text[m_position] == '\t' || m_text[m_position] == '\n' || m_text[m_position] == '\r')) {
+            m_position++;
+        }
+    }
+
+    bool consume(char c)
+    {
+        skip_whitespace();
+        if (m_position < m_text.size() && m_text[m_position] == c) {
+            m_position++;
+            return true;
+        }
+
+        return false;
+    }
+
+    bool consume(std::string_view literal)
+    {
+        if (m_text.substr(m_position, literal.size()) == literal) {
+            m_position += literal.size();
+            return true;
+        }
+
+        return false;
+    }
+
+    std::string_view parse_string()
+    {
+        ASSERT(consume('"'), "Expected a JSON string");
+
+        auto begin = m_position;
+        while (m_position < m_text.size() && m_text[m_position] != '"') {
+            m_position += m_text[m_position] == '\\' ? 2 : 1;
+        }
+
+        ASSERT(m_position < m_text.size(), "Unterminated JSON string");
+
+        return m_text.substr(begin, m_position++ - begin);
+    }
+
+    JsonValue parse_value(uint32_t depth)
+    {
+        ASSERT(depth < MAX_JSON_DEPTH, "JSON is nested too deeply");
+        skip_whitespace();
+        ASSERT(m_position < m_text.size(), "Unexpected end of JSON");
+
+        JsonValue value;
+        char c = m_text[m_position];
+
+        if (c == '{') {
+            value.type = JsonValue::Type::Object;
+            m_position++;
+
+            if (consume('}')) {
+                return value;
+            }
+
+            do {
+                auto key = parse_string();
+                ASSERT(consume(':'), "Expected ':' in JSON object");
+                value.object.emplace_back(key, parse_value(depth + 1));
+            } while (consume(','));
+
+            ASSERT(consume('}'), "Expected '}' in JSON object");
+        } else if (c == '[') {
+            value.type = JsonValue::Type::Array;
+            m_position++;
+
+            if (consume(']')) {
+                return value;
+            }
+
+            do {
+                value.array.push_back(parse_value(depth + 1));
+            } while (consume(','));
+
+            ASSERT(consume(']'), "Expected ']' in JSON array");
+        } else if (c == '"') {
+            value.type = JsonValue::Type::String;
+            value.string = parse_string();
+        } else if (consume("true") || consume("false")) {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = c == 't';
+        } else if (consume("null")) {
+            value.type = JsonValue::Type::Null;
+        } else {
+            value.type = JsonValue::Type::Number;
+            auto [end, error] = std::from_chars(m_text.data() + m_position, m_text.data() + m_text.size(), value.number);
+            ASSERT(error == std::errc(), "Malformed JSON value");
+            m_position = end - m_text.data();
+        }
+
+        return value;
+    }
+
+    std::string_view m_text;
+    size_t m_position = 0;
+};
+
+constexpr uint32_t GLB_MAGIC = 0x46546c67;
+constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a;
+constexpr uint32_t GLB_CHUNK_BIN = 0x004e4942;
+
+constexpr uint32_t GLTF_BYTE = 5120;
+constexpr uint32_t GLTF_UNSIGNED_BYTE = 5121;
+constexpr uint32_t GLTF_SHORT = 5122;
+constexpr uint32_t GLTF_UNSIGNED_SHORT = 5123;
+constexpr uint32_t GLTF_UNSIGNED_INT = 5125;
+constexpr uint32_t GLTF_FLOAT = 5126;
+
+constexpr uint32_t GLTF_TRIANGLES = 4;
+
+struct GlbHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t length;
+};
+
+struct GlbChunkHeader {
+    uint32_t length;
+    uint32_t type;
+};
+
+static uint32_t component_size(uint32_t component_type)
+{
+    switch (component_type) {
+    case GLTF_BYTE:
+    case GLTF_UNSIGNED_BYTE:
+        return 1;
+    case GLTF_SHORT:
+    case GLTF_UNSIGNED_SHORT:
+        return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT:
+        return 4;
+    }
+
+    PANIC("Unknown glTF component type");
+}
+
+static uint32_t component_count(std::string_view type)
+{
+    if (type == "SCALAR")
+        return 1;
+    if (type == "VEC2")
+        return 2;
+    if (type == "VEC3")
+        return 3;
+    if (type == "VEC4")
+        return 4;
+
+    PANIC("Unsupported glTF accessor type");
+}
+
+// Strided view of one attribute, elements are read with memcpy since glTF only guarantees component alignment
+struct GlbAccessor {
+    const uint8_t* data = nullptr;
+    uint32_t count = 0;
+    uint32_t stride = 0;
+    uint32_t component_type = 0;
+    uint32_t components = 0;
+    bool normalized = false;
+
+    template<typename T>
+    T load(uint32_t element, uint32_t component) const
+    {
+        T value = {};
+        memcpy(&value, data + static_cast<size_t>(element) * stride + component * sizeof(T), sizeof(T));
+        return value;
+    }
+
+    float read(uint32_t element, uint32_t component) const
+    {
+        if (component >= components) {
+            return 0.0f;
+        }
+
+        switch (component_type) {
+        case GLTF_FLOAT:
+            return load<float>(element, component);
+        case GLTF_UNSIGNED_BYTE:
+            return load<uint8_t>(element, component) / (normalized ? 255.0f : 1.0f);
+        case GLTF_UNSIGNED_SHORT:
+            return load<uint16_t>(element, component) / (normalized ? 65535.0f : 1.0f);
+        case GLTF_BYTE:
+            return normalized ? std::max(load<int8_t>(element, component) / 127.0f, -1.0f) : load<int8_t>(element, component);
+        case GLTF_SHORT:
+            return normalized ? std::max(load<int16_t>(element, component) / 32767.0f, -1.0f) : load<int16_t>(element, component);
+        }
+
+        PANIC("Unsupported glTF component type for a vertex attribute");
+    }
+
+    uint32_t read_index(uint32_t element) const
+    {
+        switch (component_type) {
+        case GLTF_UNSIGNED_BYTE:
+            return load<uint8_t>(element, 0);
+        case GLTF_UNSIGNED_SHORT:
+            return load<uint16_t>(element, 0);
+        case GLTF_UNSIGNED_INT:
+            return load<uint32_t>(element, 0);
+        }
+
+        PANIC("Unsupported glTF component type for indices");
+    }
+};
+
+static GlbAccessor load_accessor(const JsonValue& gltf, std::string_view bin, uint32_t index)
+{
+    auto* accessors = gltf.find("accessors");
+    auto* views = gltf.find("bufferViews");
+    ASSERT(accessors && index < accessors->array.size(), "glTF accessor is out of range");
+
+    auto& accessor = accessors->array[index];
+    auto view_index = accessor.get_uint("bufferView", ~0u);
+    ASSERT(views && view_index < views->array.size(), "glTF accessors without a buffer view are not supported");
+    ASSERT(!accessor.find("sparse"), "Sparse glTF accessors are not supported");
+
+    auto& view = views->array[view_index];
+    ASSERT(view.get_uint("buffer", 0) == 0, "Only the GLB binary chunk is supported as a glTF buffer");
+
+    auto* type = accessor.find("type");
+    ASSERT(type != nullptr, "glTF accessor has no type");
+
+    GlbAccessor result = {
+        .count = accessor.get_uint("count", 0),
+        .component_type = accessor.get_uint("componentType", 0),
+        .components = component_count(type->string),
+    };
+
+    auto* normalized = accessor.find("normalized");
+    result.normalized = normalized && normalized->boolean;
+
+    auto element_size = component_size(result.component_type) * result.components;
+    result.stride = view.get_uint("byteStride", element_size);
+
+    size_t view_offset = view.get_uint("byteOffset", 0);
+    size_t view_length = view.get_uint("byteLength", 0);
+    size_t offset = accessor.get_uint("byteOffset", 0);
+    ASSERT(view_offset + view_length <= bin.size(), "glTF buffer view is out of bounds");
+
+    if (result.count > 0) {
+        ASSERT(offset + static_cast<size_t>(result.count - 1) * result.stride + element_size <= view_length, "glTF accessor is out of bounds");
+    }
+
+    result.data = reinterpret_cast<const uint8_t*>(bin.data()) + view_offset + offset;
+
+    return result;
+}
+
+struct GlbPrimitive {
+    GlbAccessor positions;
+    GlbAccessor normals;
+    GlbAccessor uvs;
+    GlbAccessor indices;
+    uint32_t first_vertex = 0;
+    uint32_t first_index = 0;
+    uint32_t index_count = 0;
+};
+
+struct GlbTask {
+    uint32_t primitive;
+    uint32_t begin;
+    uint32_t end;
+    bool indices;
+};
+
+Mesh import_glb(const MappedFile& file)
+{
+    GlbHeader header = {};
+    ASSERT(file.size() >= sizeof(header), "GLB file is truncated");
+    memcpy(&header, file.data(), sizeof(header));
+    ASSERT(header.magic == GLB_MAGIC && header.version == 2, "Not a glTF 2.0 binary file");
+
+    std::string_view json;
+    std::string_view bin;
+    auto end = std::min<size_t>(header.length, file.size());
+
+    for (size_t offset = sizeof(header); offset + sizeof(GlbChunkHeader) <= end;) {
+        GlbChunkHeader chunk = {};
+        memcpy(&chunk, file.data() + offset, sizeof(chunk));
+        offset += sizeof(chunk);
+        ASSERT(offset + chunk.length <= end, "GLB chunk is truncated");
+
+        std::string_view data(reinterpret_cast<const char*>(file.data()) + offset, chunk.length);
+        if (chunk.type == GLB_CHUNK_JSON && json.empty()) {
+            json = data;
+        } else if (chunk.type == GLB_CHUNK_BIN && bin.empty()) {
+            bin = data;
+        }
+
+        offset += chunk.length;
+    }
+
+    ASSERT(!json.empty(), "GLB file has no JSON chunk");
+    auto gltf = JsonParser(json).parse();
+
+    std::vector<GlbPrimitive> primitives;
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+
+    if (auto* meshes = gltf.find("meshes")) {
+        for (auto& mesh : meshes->array) {
+            auto* mesh_primitives = mesh.find("primitives");
+            if (!mesh_primitives) {
+                continue;
+            }
+
+            for (auto& primitive : mesh_primitives->array) {
+                auto* attributes = primitive.find("attributes");
+                if (primitive.get_uint("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES || !attributes || !attributes->find("POSITION")) {
+                    warning("Skipping glTF primitive which isn't a triangle list with positions");
+                    continue;
+                }
+
+                GlbPrimitive result = {
+                    .positions = load_accessor(gltf, bin, attributes->get_uint("POSITION", 0)),
+                    .first_vertex = vertex_count,
+                    .first_index = index_count,
+                };
+
+                if (attributes->find("NORMAL")) {
+                    result.normals = load_accessor(gltf, bin, attributes->get_uint("NORMAL", 0));
+                    ASSERT(result.normals.count == result.positions.count, "glTF attributes differ in length");
+                }
+
+                if (attributes->find("TEXCOORD_0")) {
+                    result.uvs = load_accessor(gltf, bin, attributes->get_uint("TEXCOORD_0", 0));
+                    ASSERT(result.uvs.count == result.positions.count, "glTF attributes differ in length");
+                }
+
+                // Non-indexed primitives get an identity index list, so the whole mesh can stay indexed
+                result.index_count = result.positions.count;
+                if (primitive.find("indices")) {
+                    result.indices = load_accessor(gltf, bin, primitive.get_uint("indices", 0));
+                    result.index_count = result.indices.count;
+                }
+
+                vertex_count += result.positions.count;
+                index_count += result.index_count;
+                primitives.push_back(result);
+            }
+        }
+    }
+
+    std::vector<GlbTask> tasks;
+    for (uint32_t i = 0; i < primitives.size(); i++) {
+        for (uint32_t begin = 0; begin < primitives[i].positions.count; begin += GLB_TASK_SIZE) {
+            tasks.push_back({i, begin, std::min(begin + GLB_TASK_SIZE, primitives[i].positions.count), false});
+        }
+
+        for (uint32_t begin = 0; begin < primitives[i].index_count; begin += GLB_TASK_SIZE) {
+            tasks.push_back({i, begin, std::min(begin + GLB_TASK_SIZE, primitives[i].index_count), true});
+        }
+    }
+
+    if (std::any_of(primitives.begin(), primitives.end(), [](const GlbPrimitive& primitive) { return !primitive.normals.data; })) {
+        warning("glTF primitive has no normals, they are left as zero");
+    }
+
+    Mesh mesh;
+    float* vertices = mesh.append_vertices(vertex_count);
+    uint32_t* indices = mesh.append_indices(index_count);
+
+    parallel_for(static_cast<uint32_t>(tasks.size()), [&](uint32_t i) {
+        auto& task = tasks[i];
+        auto& primitive = primitives[task.primitive];
+
+        for (uint32_t element = task.begin; element < task.end; element++) {
+            if (task.indices) {
+                auto index = primitive.indices.data ? primitive.indices.read_index(element) : element;
+                ASSERT(index < primitive.positions.count, "glTF index is out of range");
+                indices[primitive.first_index + element] = primitive.first_vertex + index;
+                continue;
+            }
+
+            auto& positions = primitive.positions;
+            auto& normals = primitive.normals;
+            auto& uvs = primitive.uvs;
+
+            write_vertex(
+                &vertices[static_cast<size_t>(primitive.first_vertex + element) * VERTEX_FLOATS],
+                Vector3(positions.read(element, 0), positions.read(element, 1), positions.read(element, 2)),
+                normals.data ? Vector3(normals.read(element, 0), normals.read(element, 1), normals.read(element, 2)) : Vector3(0.0f),
+                uvs.data ? Vector2(uvs.read(element, 0), uvs.read(element, 1)) : Vector2(0.0f, 0.0f));
+        }
+    });
+
+    return mesh;
+}
+
+Mesh import_mesh(const char* path)
+{
+    auto then = std::chrono::high_resolution_clock::now();
+
+    MappedFile file(path);
+    ASSERT(file.is_open(), "Can't open mesh file");
+
+    std::string_view name(path);
+    auto extension = name.substr(std::min(name.rfind('.'), name.size()));
+
+    Mesh mesh;
+    if (extension == ".obj") {
+        mesh = import_obj(file);
+    } else if (extension == ".glb") {
+        mesh = import_glb(file);
+    } else {
+        PANIC("Unsupported mesh format, expected .obj or .glb");
+    }
+
+    auto elapsed = std::chrono::high_resolution_clock::now() - then;
+    info("Imported {}: {} vertices in {:.02f}ms", path, mesh.vertex_count(), std::chrono::duration<float, std::milli>(elapsed).count());
+
+    return mesh;
+}
+}
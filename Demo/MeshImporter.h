@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Demo/Common/MappedFile.h>
+#include <Demo/Mesh.h>
+
+namespace Demo {
+// Picks the importer from the extension, .obj or .glb
+Mesh import_mesh(const char* path);
+
+// Faces are triangulated as fans, missing normals are replaced by face normals
+Mesh import_obj(const MappedFile& file);
+
+// Merges every triangle primitive of every mesh in the embedded buffer.
+// Node transforms are not applied, so vertices stay in mesh space
+Mesh import_glb(const MappedFile& file);
+}
@@ -1,8 +1,8 @@
 #include <Demo/Common/Log.h>
 #include <Demo/Pipeline.h>
 
-#include <algorithm>
 #include <array>
+#include <cstddef>
 
 namespace Demo {
 static VkPipelineLayout create_pipeline_layout(
@@ -25,14 +25,51 @@ static VkPipelineLayout create_pipeline_layout(
     return layout;
 }
 
-static VkPipeline create_pipeline(VkDevice device, std::optional<VertexLayout> vertex_layout, VkRenderPass render_pass, VkPipelineLayout layout, Shader vertex, Shader fragment)
+static std::vector<VkSpecializationMapEntry> specialization_map_entries(const std::vector<SpecializationConstant>& specialization_constants)
 {
+    std::vector<VkSpecializationMapEntry> map_entries;
+    for (uint32_t i = 0; i < specialization_constants.size(); i++) {
+        map_entries.push_back({
+            .constantID = specialization_constants[i].id,
+            .offset = static_cast<uint32_t>(i * sizeof(SpecializationConstant) + offsetof(SpecializationConstant, value)),
+            .size = sizeof(uint32_t),
+        });
+    }
+
+    return map_entries;
+}
+
+// Constants are read straight out of the descriptions, which must outlive pipeline creation
+static VkSpecializationInfo create_specialization_info(const std::vector<SpecializationConstant>& specialization_constants, const std::vector<VkSpecializationMapEntry>& map_entries)
+{
+    return {
+        .mapEntryCount = static_cast<uint32_t>(map_entries.size()),
+        .pMapEntries = map_entries.data(),
+        .dataSize = specialization_constants.size() * sizeof(SpecializationConstant),
+        .pData = specialization_constants.data(),
+    };
+}
+
+static VkPipeline create_pipeline(
+    VkDevice device,
+    VkPipelineCache pipeline_cache,
+    std::optional<VertexLayout> vertex_layout,
+    VkRenderPass render_pass,
+    const VkPipelineRenderingCreateInfoKHR* rendering_info,
+    VkPipelineLayout layout,
+    Shader vertex,
+    Shader fragment,
+    const std::vector<SpecializationConstant>& specialization_constants)
+{
+    auto map_entries = specialization_map_entries(specialization_constants);
+    auto specialization_info = create_specialization_info(specialization_constants, map_entries);
+
     VkPipelineShaderStageCreateInfo vertex_stage = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .stage = VK_SHADER_STAGE_VERTEX_BIT,
         .module = vertex.raw(),
         .pName = "main",
-        .pSpecializationInfo = nullptr,
+        .pSpecializationInfo = &specialization_info,
     };
 
     VkPipelineShaderStageCreateInfo fragment_stage = {
@@ -40,7 +77,7 @@ static VkPipeline create_pipeline(VkDevice device, std::optional<VertexLayout> v
         .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
         .module = fragment.raw(),
         .pName = "main",
-        .pSpecializationInfo = nullptr,
+        .pSpecializationInfo = &specialization_info,
     };
 
     std::array stages = {vertex_stage, fragment_stage};
@@ -93,8 +130,8 @@ static VkPipeline create_pipeline(VkDevice device, std::optional<VertexLayout> v
         .depthClampEnable = VK_FALSE,
         .rasterizerDiscardEnable = VK_FALSE,
         .polygonMode = VK_POLYGON_MODE_FILL,
-        .cullMode = VK_CULL_MODE_NONE,
-        .frontFace = VK_FRONT_FACE_CLOCKWISE,
+        .cullMode = desc.cull_mode,
+        .frontFace = desc.front_face,
         .depthBiasEnable = VK_FALSE,
         .depthBiasConstantFactor = 0.0f,
         .depthBiasClamp = 0.0f,
@@ -139,6 +176,7 @@ static VkPipeline create_pipeline(VkDevice device, std::optional<VertexLayout> v
 
     VkGraphicsPipelineCreateInfo pipeline_create_info = {
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = rendering_info,
         .stageCount = static_cast<uint32_t>(stages.size()),
         .pStages = stages.data(),
         .pVertexInputState = &vertex_input_state,
@@ -158,7 +196,7 @@ static VkPipeline create_pipeline(VkDevice device, std::optional<VertexLayout> v
     };
 
     VkPipeline pipeline = VK_NULL_HANDLE;
-    auto result = vkCreateGraphicsPipelines(device, nullptr, 1, &pipeline_create_info, nullptr, &pipeline);
+    auto result = vkCreateGraphicsPipelines(device, pipeline_cache, 1, &pipeline_create_info, nullptr, &pipeline);
     VK_ASSERT(result);
 
     return pipeline;
@@ -168,23 +206,24 @@ GraphicsPipeline::GraphicsPipeline(GraphicsPipelineDesc desc)
 {
     m_device = desc.device;
 
-    std::vector<RenderPassImage> images;
-    std::transform(desc.images.begin(), desc.images.end(), std::back_inserter(images), [](VkFormat format) {
-        return RenderPassImage{
-            .format = format,
-            .load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-            .store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-        };
-    });
+    VkPipelineRenderingCreateInfoKHR rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR,
+        .viewMask = 0,
+        .colorAttachmentCount = static_cast<uint32_t>(desc.images.size()),
+        .pColorAttachmentFormats = desc.images.data(),
+        .depthAttachmentFormat = VK_FORMAT_UNDEFINED,
+        .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+    };
 
-    RenderPass render_pass({
-        .device = m_device,
-        .size = Vector2u(1, 1),
-        .images = images,
-    });
+    VkRenderPass render_pass = VK_NULL_HANDLE;
+    if (!desc.dynamic_rendering) {
+        ASSERT(desc.render_pass_cache, "Graphics pipeline needs a render pass cache");
+        render_pass = desc.render_pass_cache->compatible(desc.images).raw();
+    }
 
     m_layout = create_pipeline_layout(m_device, desc.descriptor_set_layouts, desc.push_constant_ranges);
-    m_pipeline = create_pipeline(m_device, desc.vertex_layout, render_pass.raw(), m_layout, move(desc.vertex_shader), move(desc.fragment_shader));
+    auto rendering = desc.dynamic_rendering ? &rendering_info : nullptr;
+    m_pipeline = create_pipeline(m_device, desc.pipeline_cache, desc.vertex_layout, render_pass, rendering, m_layout, move(desc.vertex_shader), move(desc.fragment_shader), desc.specialization_constants);
 }
 
 GraphicsPipeline::~GraphicsPipeline()
@@ -194,4 +233,38 @@ GraphicsPipeline::~GraphicsPipeline()
         vkDestroyPipelineLayout(m_device, m_layout, nullptr);
     }
 }
+
+ComputePipeline::ComputePipeline(ComputePipelineDesc desc)
+{
+    m_device = desc.device;
+    m_layout = create_pipeline_layout(m_device, desc.descriptor_set_layouts, desc.push_constant_ranges);
+
+    auto map_entries = specialization_map_entries(desc.specialization_constants);
+    auto specialization_info = create_specialization_info(desc.specialization_constants, map_entries);
+
+    VkComputePipelineCreateInfo pipeline_create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module = desc.compute_shader.raw(),
+            .pName = "main",
+            .pSpecializationInfo = &specialization_info,
+        },
+        .layout = m_layout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = 0,
+    };
+
+    auto result = vkCreateComputePipelines(m_device, desc.pipeline_cache, 1, &pipeline_create_info, nullptr, &m_pipeline);
+    VK_ASSERT(result);
+}
+
+ComputePipeline::~ComputePipeline()
+{
+    if (m_device) {
+        vkDestroyPipeline(m_device, m_pipeline, nullptr);
+        vkDestroyPipelineLayout(m_device, m_layout, nullptr);
+    }
+}
 }
@@ -1,22 +1,37 @@
 #pragma once
 
 #include <Demo/Mesh.h>
-#include <Demo/RenderPass.h>
+#include <Demo/RenderPassCache.h>
 #include <Demo/RendererBase.h>
 #include <Demo/Shader.h>
 #include <vector>
 #include <optional>
 
 namespace Demo {
+// Applied to every stage of the pipeline, shaders ignore IDs they don't declare
+struct SpecializationConstant {
+    uint32_t id;
+    uint32_t value;
+};
+
 struct GraphicsPipelineDesc {
     VkDevice device;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+
+    // Provides a render pass compatible with the images the pipeline draws into
+    RenderPassCache* render_pass_cache = nullptr;
+    // Pipeline is used by render passes with dynamic rendering, it only needs the image formats
+    bool dynamic_rendering = false;
     std::optional<VertexLayout> vertex_layout;
     std::vector<VkDescriptorSetLayout> descriptor_set_layouts;
     std::vector<VkPushConstantRange> push_constant_ranges;
+    VkCullModeFlags cull_mode = VK_CULL_MODE_NONE;
+    VkFrontFace front_face = VK_FRONT_FACE_CLOCKWISE;
 
     Shader vertex_shader;
     Shader fragment_shader;
     std::vector<VkFormat> images;
+    std::vector<SpecializationConstant> specialization_constants;
 };
 
 class GraphicsPipeline : NonCopyable {
@@ -42,6 +57,45 @@ public:
         return *this;
     }
 
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPipelineLayout m_layout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+};
+
+struct ComputePipelineDesc {
+    VkDevice device;
+    VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSetLayout> descriptor_set_layouts;
+    std::vector<VkPushConstantRange> push_constant_ranges;
+
+    Shader compute_shader;
+    std::vector<SpecializationConstant> specialization_constants;
+};
+
+class ComputePipeline : NonCopyable {
+public:
+    ComputePipeline() = default;
+    ComputePipeline(ComputePipelineDesc desc);
+    ~ComputePipeline();
+
+    VkPipelineLayout layout() const { return m_layout; }
+    VkPipeline raw() const { return m_pipeline; }
+
+    ComputePipeline(ComputePipeline&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    ComputePipeline& operator=(ComputePipeline&& other) noexcept
+    {
+        swap(m_device, other.m_device);
+        swap(m_layout, other.m_layout);
+        swap(m_pipeline, other.m_pipeline);
+
+        return *this;
+    }
+
 private:
     VkDevice m_device = VK_NULL_HANDLE;
     VkPipelineLayout m_layout = VK_NULL_HANDLE;
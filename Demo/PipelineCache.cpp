@@ -0,0 +1,96 @@
+#include <Demo/Common/AtomicFile.h>
+#include <Demo/Common/Log.h>
+#include <Demo/PipelineCache.h>
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace Demo {
+// Layout of VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+struct CacheHeader {
+    uint32_t header_size;
+    uint32_t header_version;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint8_t uuid[VK_UUID_SIZE];
+};
+
+static_assert(sizeof(CacheHeader) == 32);
+
+static std::vector<uint8_t> load_cache_data(const std::string& path, VkPhysicalDevice physical_device)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs.good()) {
+        return {};
+    }
+
+    std::vector<uint8_t> data(std::istreambuf_iterator<char>(ifs), {});
+
+    CacheHeader header = {};
+    if (data.size() < sizeof(header)) {
+        warning("Pipeline cache {} is truncated", path);
+        return {};
+    }
+
+    memcpy(&header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+
+    // Drivers should reject foreign data themselves, but not all of them do
+    bool valid = header.header_size >= sizeof(header)
+        && header.header_version == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendor_id == properties.vendorID
+        && header.device_id == properties.deviceID
+        && memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+    if (!valid) {
+        warning("Pipeline cache {} was created by another device or driver", path);
+        return {};
+    }
+
+    return data;
+}
+
+PipelineCache::PipelineCache(VkDevice device, VkPhysicalDevice physical_device, std::string path)
+{
+    m_device = device;
+    m_path = move(path);
+
+    auto data = load_cache_data(m_path, physical_device);
+
+    VkPipelineCacheCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .initialDataSize = data.size(),
+        .pInitialData = data.data(),
+    };
+
+    auto result = vkCreatePipelineCache(m_device, &create_info, nullptr, &m_cache);
+    VK_ASSERT(result);
+
+    debug("Loaded {} bytes of pipeline cache from {}", data.size(), m_path);
+}
+
+PipelineCache::~PipelineCache()
+{
+    if (m_device) {
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    }
+}
+
+void PipelineCache::save() const
+{
+    size_t size = 0;
+    VK_ASSERT(vkGetPipelineCacheData(m_device, m_cache, &size, nullptr));
+
+    std::vector<uint8_t> data(size);
+    VK_ASSERT(vkGetPipelineCacheData(m_device, m_cache, &size, data.data()));
+
+    if (!write_file_atomically(m_path, {std::span(data.data(), size)})) {
+        return;
+    }
+
+    debug("Saved {} bytes of pipeline cache to {}", size, m_path);
+}
+}
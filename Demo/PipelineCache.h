@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Demo/RendererBase.h>
+
+#include <string>
+
+namespace Demo {
+class PipelineCache : NonCopyable {
+public:
+    PipelineCache() = default;
+
+    // Starts empty if the file is missing or was written by another device or driver
+    PipelineCache(VkDevice device, VkPhysicalDevice physical_device, std::string path);
+    ~PipelineCache();
+
+    VkPipelineCache raw() const { return m_cache; }
+
+    // Replaces the file atomically, so concurrent processes never read a partial cache
+    void save() const;
+
+    PipelineCache(PipelineCache&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    PipelineCache& operator=(PipelineCache&& other) noexcept
+    {
+        swap(m_device, other.m_device);
+        swap(m_cache, other.m_cache);
+        swap(m_path, other.m_path);
+
+        return *this;
+    }
+
+private:
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    std::string m_path;
+};
+}
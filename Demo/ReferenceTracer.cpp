@@ -0,0 +1,490 @@
+#include <Demo/Common/Base.h>
+#include <Demo/Common/Jobs.h>
+#include <Demo/Common/Simd.h>
+#include <Demo/Config.h>
+#include <Demo/ReferenceTracer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace Demo {
+// Constants and algorithms below must match Shaders/pathtrace.comp and the files it includes,
+// otherwise the two images stop converging to the same result
+
+constexpr float FAR = 1e30f;
+constexpr Vector3 UP = {0.0f, 1.0f, 0.0f};
+constexpr uint32_t BVH_STACK_SIZE = 64;
+
+// Same tiles as the workgroups of the compute shader, packets run along rows of a tile
+constexpr uint32_t TILE_SIZE = 8;
+constexpr uint32_t PACKET_SIZE = 4;
+
+// Hit primitives are tracked in float lanes next to distances, indices stay exact below 2^24
+constexpr float NO_PRIMITIVE = -1.0f;
+constexpr float ANIMATED_BOX = -2.0f;
+
+static const Vector3 SUN = normalize({0.3f, 0.5f, 0.7f});
+
+struct RandomState {
+    uint32_t s0;
+    uint32_t s1;
+};
+
+static uint32_t rotl(uint32_t x, uint32_t k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+static uint32_t xoroshiro64star(RandomState& s)
+{
+    uint32_t result = s.s0 * 0x9E3779BB;
+
+    s.s1 ^= s.s0;
+    s.s0 = rotl(s.s0, 26) ^ s.s1 ^ (s.s1 << 9);
+    s.s1 = rotl(s.s1, 13);
+
+    return result;
+}
+
+static uint32_t pcg_hash(uint32_t x)
+{
+    uint32_t state = x * 747796405u + 2891336453u;
+    uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+static RandomState seed_random(uint32_t x, uint32_t y, uint32_t frame_index)
+{
+    uint32_t s0 = pcg_hash(x ^ pcg_hash(y));
+    uint32_t s1 = pcg_hash(frame_index ^ s0);
+
+    return {s0, s1 | 1u};
+}
+
+static float random(RandomState& state)
+{
+    uint32_t bits = (xoroshiro64star(state) & 0x007FFFFFu) | 0x3F800000u;
+
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value - 1.0f;
+}
+
+static Vector3 uniform_on_sphere(RandomState& state)
+{
+    float phi = 2 * PI * random(state);
+    float cos_theta = 2 * random(state) - 1;
+    float sin_theta = std::sqrt(1 - cos_theta * cos_theta);
+
+    return {sin_theta * std::cos(phi), cos_theta, sin_theta * std::sin(phi)};
+}
+
+static Vector3 cosine_weighted_on_hemisphere(RandomState& state, Vector3 normal)
+{
+    return normalize(normal + uniform_on_sphere(state));
+}
+
+static Vector3 sample_sky(Vector3 dir)
+{
+    const float sun_radius = 696340; // in kilometers
+    const float distance_to_sun = 150e6; // in kilometers
+    const float angular_size = 2 * std::atan(sun_radius / distance_to_sun);
+
+    return dot(dir, SUN) > std::cos(angular_size) ? Vector3(10, 10, 10) : Vector3(0.7f, 0.8f, 0.9f);
+}
+
+static Vector3 generate_ray(uint32_t x, uint32_t y, Vector2u size, const Uniforms& uniforms, const Camera& camera, RandomState& state)
+{
+    Vector3 look_dir = normalize(camera.look_dir.xyz());
+
+    // Arguments of vec2() are evaluated left to right in GLSL, C++ leaves the order unspecified
+    float jitter_x = random(state);
+    float jitter_y = random(state);
+    float u_coord = (x + jitter_x) / static_cast<float>(size.width);
+    float v_coord = (y + jitter_y) / static_cast<float>(size.height);
+
+    float scale = 2 * std::tan(radians(uniforms.fov) / 2);
+    Vector3 u = normalize(cross(look_dir, UP)) * scale * uniforms.aspect_ratio;
+    Vector3 v = normalize(cross(u, look_dir)) * scale;
+
+    return normalize(look_dir + u * (u_coord - 0.5f) - v * (v_coord - 0.5f));
+}
+
+// Structure of arrays with one ray per lane
+struct Vector3x4 {
+    Float4 x, y, z;
+
+    static Vector3x4 splat(Vector3 v) { return {Float4::splat(v.x), Float4::splat(v.y), Float4::splat(v.z)}; }
+};
+
+static Vector3x4 operator-(const Vector3x4& lhs, const Vector3x4& rhs) { return {lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z}; }
+static Vector3x4 operator*(const Vector3x4& lhs, const Vector3x4& rhs) { return {lhs.x * rhs.x, lhs.y * rhs.y, lhs.z * rhs.z}; }
+
+static Float4 dot(const Vector3x4& lhs, const Vector3x4& rhs)
+{
+    return multiply_add(lhs.x, rhs.x, multiply_add(lhs.y, rhs.y, lhs.z * rhs.z));
+}
+
+static Vector3x4 cross(const Vector3x4& lhs, const Vector3x4& rhs)
+{
+    return {
+        lhs.y * rhs.z - lhs.z * rhs.y,
+        lhs.z * rhs.x - lhs.x * rhs.z,
+        lhs.x * rhs.y - lhs.y * rhs.x,
+    };
+}
+
+static Vector3x4 select(Mask4 mask, const Vector3x4& if_true, const Vector3x4& if_false)
+{
+    return {select(mask, if_true.x, if_false.x), select(mask, if_true.y, if_false.y), select(mask, if_true.z, if_false.z)};
+}
+
+static float min_lane(Float4 v)
+{
+    float lanes[4];
+    v.store(lanes);
+    return std::min({lanes[0], lanes[1], lanes[2], lanes[3]});
+}
+
+struct RayPacket {
+    Vector3x4 origin;
+    Vector3x4 dir;
+    Vector3x4 inv_dir;
+};
+
+// Closest hit of every lane. Lanes without a ray start at distance zero so nothing is ever recorded for them
+struct HitPacket {
+    Float4 distance;
+    Vector3x4 normal;
+    Float4 primitive;
+};
+
+static void record_hit(HitPacket& hit, Mask4 intersects, Float4 distance, const Vector3x4& normal, float primitive)
+{
+    auto closer = intersects & (distance < hit.distance);
+
+    hit.distance = select(closer, distance, hit.distance);
+    hit.normal = select(closer, normal, hit.normal);
+    hit.primitive = select(closer, Float4::splat(primitive), hit.primitive);
+}
+
+static Float4 negative_sign(Float4 v)
+{
+    auto zero = Float4::splat(0.0f);
+    return select(v > zero, Float4::splat(-1.0f), select(v < zero, Float4::splat(1.0f), zero));
+}
+
+// Majercik, Journal of Computer Graphics Techniques (JCGT), vol. 7, no. 3
+// http://jcgt.org/published/0007/03/04/
+static void intersect_box(Vector3 center, Vector3 radius, const RayPacket& ray, float primitive, HitPacket& hit)
+{
+    auto zero = Float4::splat(0.0f);
+    auto one = Float4::splat(1.0f);
+    auto r = Vector3x4::splat(radius);
+    auto inv_r = Vector3x4::splat({1.0f / radius.x, 1.0f / radius.y, 1.0f / radius.z});
+
+    auto o = ray.origin - Vector3x4::splat(center);
+    auto inside = max(max(abs(o.x) * inv_r.x, abs(o.y) * inv_r.y), abs(o.z) * inv_r.z) < one;
+    auto winding = select(inside, Float4::splat(-1.0f), one);
+
+    Vector3x4 sgn = {negative_sign(ray.dir.x), negative_sign(ray.dir.y), negative_sign(ray.dir.z)};
+    Vector3x4 d = {
+        (r.x * winding * sgn.x - o.x) * ray.inv_dir.x,
+        (r.y * winding * sgn.y - o.y) * ray.inv_dir.y,
+        (r.z * winding * sgn.z - o.z) * ray.inv_dir.z,
+    };
+
+    auto test_x = (d.x >= zero) & (abs(multiply_add(ray.dir.y, d.x, o.y)) < r.y) & (abs(multiply_add(ray.dir.z, d.x, o.z)) < r.z);
+    auto test_y = (d.y >= zero) & (abs(multiply_add(ray.dir.z, d.y, o.z)) < r.z) & (abs(multiply_add(ray.dir.x, d.y, o.x)) < r.x);
+    auto test_z = (d.z >= zero) & (abs(multiply_add(ray.dir.x, d.z, o.x)) < r.x) & (abs(multiply_add(ray.dir.y, d.z, o.y)) < r.y);
+
+    Vector3x4 normal = {
+        select(test_x, sgn.x, zero),
+        select((!test_x) & test_y, sgn.y, zero),
+        select((!test_x) & (!test_y) & test_z, sgn.z, zero),
+    };
+
+    auto hit_x = normal.x != zero;
+    auto hit_y = normal.y != zero;
+    auto hit_z = normal.z != zero;
+    auto distance = select(hit_x, d.x, select(hit_y, d.y, d.z));
+
+    record_hit(hit, hit_x | hit_y | hit_z, distance, normal, primitive);
+}
+
+// Moller, Trumbore, Fast, Minimum Storage Ray/Triangle Intersection
+static void intersect_triangle(Vector3 a, Vector3 b, Vector3 c, const RayPacket& ray, float primitive, HitPacket& hit)
+{
+    auto zero = Float4::splat(0.0f);
+    auto one = Float4::splat(1.0f);
+
+    Vector3 edge1 = b - a;
+    Vector3 edge2 = c - a;
+    auto e1 = Vector3x4::splat(edge1);
+    auto e2 = Vector3x4::splat(edge2);
+
+    auto p = cross(ray.dir, e2);
+    auto determinant = dot(e1, p);
+    auto intersects = !(abs(determinant) < Float4::splat(1e-8f));
+
+    auto inv_determinant = one / determinant;
+
+    auto t = ray.origin - Vector3x4::splat(a);
+    auto u = dot(t, p) * inv_determinant;
+    intersects = intersects & !((u < zero) | (u > one));
+
+    auto q = cross(t, e1);
+    auto v = dot(ray.dir, q) * inv_determinant;
+    intersects = intersects & !((v < zero) | (u + v > one));
+
+    auto distance = dot(e2, q) * inv_determinant;
+    intersects = intersects & (distance > zero) & (distance < hit.distance);
+
+    // Normal needs a square root, skip it for the common case of a packet missing entirely
+    if (!any(intersects)) {
+        return;
+    }
+
+    auto normal = Vector3x4::splat(normalize(cross(edge1, edge2)));
+    auto flipped = Vector3x4 {zero, zero, zero} - normal;
+    normal = select(dot(normal, ray.dir) > zero, flipped, normal);
+
+    record_hit(hit, intersects, distance, normal, primitive);
+}
+
+static Float4 intersect_aabb(Vector3 box_min, Vector3 box_max, const RayPacket& ray, Float4 max_distance)
+{
+    auto t0 = (Vector3x4::splat(box_min) - ray.origin) * ray.inv_dir;
+    auto t1 = (Vector3x4::splat(box_max) - ray.origin) * ray.inv_dir;
+
+    auto near = max(max(max(min(t0.x, t1.x), min(t0.y, t1.y)), min(t0.z, t1.z)), Float4::splat(0.0f));
+    auto far = min(min(max(t0.x, t1.x), max(t0.y, t1.y)), max(t0.z, t1.z));
+
+    return select((near <= far) & (near < max_distance), near, Float4::splat(FAR));
+}
+
+static void intersect_primitive(const BVHPrimitive& primitive, uint32_t index, const RayPacket& ray, HitPacket& hit)
+{
+    if (primitive.type == PrimitiveType::Box) {
+        intersect_box(primitive.a, primitive.b, ray, float(index), hit);
+    } else {
+        intersect_triangle(primitive.a, primitive.b, primitive.c, ray, float(index), hit);
+    }
+}
+
+// Same nearest-first traversal as intersect_bvh() in Shaders/bvh.glsl, except that a node is
+// visited whenever any lane of the packet hits it
+static void intersect_bvh(const BVH& bvh, const RayPacket& ray, HitPacket& hit)
+{
+    auto& nodes = bvh.nodes();
+    auto& primitives = bvh.primitives();
+    auto far = Float4::splat(FAR);
+
+    if (!any(intersect_aabb(nodes[0].min, nodes[0].max, ray, hit.distance) != far)) {
+        return;
+    }
+
+    uint32_t stack[BVH_STACK_SIZE];
+    Float4 stack_distances[BVH_STACK_SIZE];
+    uint32_t stack_size = 0;
+
+    uint32_t node_index = 0;
+
+    while (true) {
+        const BVHNode& node = nodes[node_index];
+
+        if (node.primitive_count > 0) {
+            for (uint32_t i = node.left_first; i < node.left_first + node.primitive_count; i++) {
+                intersect_primitive(primitives[i], i, ray, hit);
+            }
+        } else {
+            uint32_t near_child = node.left_first;
+            uint32_t far_child = node.left_first + 1;
+
+            auto near_distance = intersect_aabb(nodes[near_child].min, nodes[near_child].max, ray, hit.distance);
+            auto far_distance = intersect_aabb(nodes[far_child].min, nodes[far_child].max, ray, hit.distance);
+
+            // Lanes may disagree on the order, the child closest to any lane goes first
+            if (min_lane(far_distance) < min_lane(near_distance)) {
+                std::swap(near_child, far_child);
+                std::swap(near_distance, far_distance);
+            }
+
+            bool near_hit = any(near_distance != far);
+            bool far_hit = any(far_distance != far);
+
+            if (near_hit || far_hit) {
+                if (near_hit && far_hit) {
+                    ASSERT(stack_size < BVH_STACK_SIZE, "BVH is deeper than the traversal stack");
+                    stack[stack_size] = far_child;
+                    stack_distances[stack_size] = far_distance;
+                    stack_size++;
+                }
+
+                node_index = near_hit ? near_child : far_child;
+                continue;
+            }
+        }
+
+        bool found = false;
+        while (stack_size > 0 && !found) {
+            stack_size--;
+            node_index = stack[stack_size];
+            found = any(stack_distances[stack_size] < hit.distance);
+        }
+
+        if (!found) {
+            break;
+        }
+    }
+}
+
+ReferenceTracer::ReferenceTracer(const BVH& bvh, Vector2u size)
+    : m_bvh(&bvh)
+    , m_size(size)
+    , m_accumulation(size.rectangle_area(), Vector4(0, 0, 0, 0))
+{
+    ASSERT(bvh.primitives().size() < (1u << 24), "Primitive indices must be exact in float lanes");
+    ASSERT(!bvh.nodes().empty(), "BVH must be built before tracing");
+}
+
+void ReferenceTracer::render(const Uniforms& uniforms, const Camera& camera, uint32_t frame_index)
+{
+    const Vector3 box_center = {0, 0, 0};
+    const Vector3 box_radius = Vector3(0.5f + 0.1f * std::cos(uniforms.time * PI));
+    const Vector3 box_albedo = {0.9f, 0.8f, 0.7f};
+
+    auto trace_packet = [&](uint32_t x0, uint32_t y) {
+        uint32_t lane_count = std::min(PACKET_SIZE, m_size.width - x0);
+
+        RandomState states[PACKET_SIZE];
+        Vector3 radiance[PACKET_SIZE] = {};
+
+        for (uint32_t lane = 0; lane < lane_count; lane++) {
+            states[lane] = seed_random(x0 + lane, y, frame_index);
+        }
+
+        for (uint32_t sample = 0; sample < SAMPLES_PER_FRAME; sample++) {
+            float origin[3][PACKET_SIZE] = {};
+            float dir[3][PACKET_SIZE] = {};
+            Vector3 throughput[PACKET_SIZE];
+            bool alive[PACKET_SIZE] = {};
+
+            for (uint32_t lane = 0; lane < lane_count; lane++) {
+                Vector3 ray_dir = generate_ray(x0 + lane, y, m_size, uniforms, camera, states[lane]);
+                for (uint32_t axis = 0; axis < 3; axis++) {
+                    origin[axis][lane] = camera.position[axis];
+                    dir[axis][lane] = ray_dir[axis];
+                }
+                throughput[lane] = Vector3(1.0f);
+                alive[lane] = true;
+            }
+
+            for (uint32_t bounce = 0; bounce < MAX_BOUNCES; bounce++) {
+                if (std::none_of(alive, alive + PACKET_SIZE, [](bool a) { return a; })) {
+                    break;
+                }
+
+                float start_distance[PACKET_SIZE];
+                for (uint32_t lane = 0; lane < PACKET_SIZE; lane++) {
+                    start_distance[lane] = alive[lane] ? FAR : 0.0f;
+                }
+
+                RayPacket ray;
+                ray.origin = {Float4::load(origin[0]), Float4::load(origin[1]), Float4::load(origin[2])};
+                ray.dir = {Float4::load(dir[0]), Float4::load(dir[1]), Float4::load(dir[2])};
+                auto one = Float4::splat(1.0f);
+                ray.inv_dir = {one / ray.dir.x, one / ray.dir.y, one / ray.dir.z};
+
+                auto zero = Float4::splat(0.0f);
+                HitPacket hit = {Float4::load(start_distance), {zero, zero, zero}, Float4::splat(NO_PRIMITIVE)};
+
+                // Static geometry only replaces the box hit if it's closer, same as intersect_scene()
+                intersect_box(box_center, box_radius, ray, ANIMATED_BOX, hit);
+                intersect_bvh(*m_bvh, ray, hit);
+
+                float distance[PACKET_SIZE], primitive[PACKET_SIZE];
+                float normal[3][PACKET_SIZE];
+                hit.distance.store(distance);
+                hit.primitive.store(primitive);
+                hit.normal.x.store(normal[0]);
+                hit.normal.y.store(normal[1]);
+                hit.normal.z.store(normal[2]);
+
+                // Shading is cheap next to traversal and diverges per lane, so it stays scalar
+                for (uint32_t lane = 0; lane < lane_count; lane++) {
+                    if (!alive[lane]) {
+                        continue;
+                    }
+
+                    Vector3 ray_dir = {dir[0][lane], dir[1][lane], dir[2][lane]};
+
+                    if (primitive[lane] == NO_PRIMITIVE) {
+                        radiance[lane] += throughput[lane] * sample_sky(ray_dir);
+                        alive[lane] = false;
+                        continue;
+                    }
+
+                    Vector3 hit_normal = {normal[0][lane], normal[1][lane], normal[2][lane]};
+                    Vector3 albedo = primitive[lane] == ANIMATED_BOX ? box_albedo : m_bvh->primitives()[uint32_t(primitive[lane])].albedo;
+
+                    Vector3 ray_origin = Vector3(origin[0][lane], origin[1][lane], origin[2][lane]) + ray_dir * distance[lane] + hit_normal * 0.00001f;
+                    throughput[lane] = throughput[lane] * albedo;
+                    ray_dir = cosine_weighted_on_hemisphere(states[lane], hit_normal);
+
+                    for (uint32_t axis = 0; axis < 3; axis++) {
+                        origin[axis][lane] = ray_origin[axis];
+                        dir[axis][lane] = ray_dir[axis];
+                    }
+                }
+            }
+        }
+
+        for (uint32_t lane = 0; lane < lane_count; lane++) {
+            Vector4& accumulated = m_accumulation[y * m_size.width + x0 + lane];
+            Vector4 sample = Vector4(radiance[lane], float(SAMPLES_PER_FRAME));
+            accumulated = frame_index > 0 ? accumulated + sample : sample;
+        }
+    };
+
+    uint32_t tiles_x = (m_size.width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t tiles_y = (m_size.height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // Tiles own disjoint pixels of the accumulation buffer, so workers never share writes
+    parallel_for(tiles_x * tiles_y, [&](uint32_t tile) {
+        uint32_t tile_x = (tile % tiles_x) * TILE_SIZE;
+        uint32_t tile_y = (tile / tiles_x) * TILE_SIZE;
+
+        for (uint32_t y = tile_y; y < std::min(tile_y + TILE_SIZE, m_size.height); y++) {
+            for (uint32_t x = tile_x; x < std::min(tile_x + TILE_SIZE, m_size.width); x += PACKET_SIZE) {
+                trace_packet(x, y);
+            }
+        }
+    });
+}
+
+static uint8_t encode_srgb(float linear)
+{
+    float c = std::clamp(linear, 0.0f, 1.0f);
+    c = c <= 0.0031308f ? 12.92f * c : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return uint8_t(c * 255.0f + 0.5f);
+}
+
+std::vector<uint8_t> ReferenceTracer::read_back() const
+{
+    std::vector<uint8_t> pixels(m_accumulation.size() * 4);
+
+    for (size_t i = 0; i < m_accumulation.size(); i++) {
+        Vector4 accumulated = m_accumulation[i];
+        Vector3 color = accumulated.w > 0 ? accumulated.xyz() / accumulated.w : Vector3(0.0f);
+
+        pixels[i * 4 + 0] = encode_srgb(color.z);
+        pixels[i * 4 + 1] = encode_srgb(color.y);
+        pixels[i * 4 + 2] = encode_srgb(color.x);
+        pixels[i * 4 + 3] = 255;
+    }
+
+    return pixels;
+}
+}
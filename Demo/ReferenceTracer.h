@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Demo/BVH.h>
+#include <Demo/Math.h>
+#include <Demo/Scene.h>
+
+#include <vector>
+
+namespace Demo {
+// CPU port of Shaders/pathtrace.comp, used to check GPU output without a GPU
+// and as a throughput baseline. Rays are traced in SIMD packets, one pixel per lane
+class ReferenceTracer {
+public:
+    // BVH must outlive the tracer
+    ReferenceTracer(const BVH& bvh, Vector2u size);
+
+    // Traces the same samples as one dispatch of pathtrace.comp, frame zero restarts accumulation
+    void render(const Uniforms& uniforms, const Camera& camera, uint32_t frame_index);
+
+    // Same encoding as Renderer::read_back(), BGRA with the sRGB transfer function
+    std::vector<uint8_t> read_back() const;
+
+private:
+    const BVH* m_bvh = nullptr;
+    Vector2u m_size;
+    // RGB holds the sum of radiance over all samples, A holds the number of samples
+    std::vector<Vector4> m_accumulation;
+};
+}
@@ -1,6 +1,63 @@
 #include <Demo/RenderPass.h>
 
+#include <algorithm>
+
 namespace Demo {
+static void transition_targets(
+    VkCommandBuffer cmd,
+    std::span<const RenderPassTarget> targets,
+    const std::vector<RenderPassImage>& images,
+    VkPipelineStageFlags dst_stage,
+    VkAccessFlags dst_access,
+    bool to_attachment)
+{
+    std::vector<VkImageMemoryBarrier> barriers;
+
+    for (size_t i = 0; i < targets.size(); i++) {
+        auto old_layout = to_attachment ? images[i].initial_layout : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        auto new_layout = to_attachment ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : images[i].final_layout;
+
+        // Next pass rendering into the image waits for these writes with its own barrier
+        if (!to_attachment && new_layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
+            continue;
+        }
+
+        barriers.push_back({
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask = dst_access,
+            .oldLayout = old_layout,
+            .newLayout = new_layout,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image = targets[i].image,
+            .subresourceRange = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .baseMipLevel = 0,
+                .levelCount = 1,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+        });
+    }
+
+    if (barriers.empty()) {
+        return;
+    }
+
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, dst_stage, 0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+// Loading an attachment reads what the previous pass wrote
+static VkAccessFlags attachment_access(const std::vector<RenderPassImage>& images)
+{
+    bool loads = std::any_of(images.begin(), images.end(), [](const RenderPassImage& image) {
+        return image.load_op == VK_ATTACHMENT_LOAD_OP_LOAD;
+    });
+
+    return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (loads ? VK_ACCESS_COLOR_ATTACHMENT_READ_BIT : 0);
+}
+
 RenderPass::RenderPass(const RenderPassDesc& desc)
 {
     ASSERT(desc.images.size() > 0);
@@ -22,6 +79,27 @@ RenderPass::RenderPass(const RenderPassDesc& desc)
         .extent = {m_size.width, m_size.height},
     };
 
+    for (auto image : desc.images) {
+        m_formats.push_back(image.format);
+        m_clear_values.push_back(image.clear_value);
+    }
+
+    if (desc.dynamic_rendering) {
+        m_dynamic_rendering = true;
+        m_images = desc.images;
+
+        m_rendering_inheritance = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR,
+            .colorAttachmentCount = static_cast<uint32_t>(m_formats.size()),
+            .pColorAttachmentFormats = m_formats.data(),
+            .depthAttachmentFormat = VK_FORMAT_UNDEFINED,
+            .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
+            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        };
+
+        return;
+    }
+
     std::vector<VkAttachmentDescription> attachments;
     std::vector<VkAttachmentReference> attachment_refs;
     std::vector<VkFramebufferAttachmentImageInfo> framebuffer_attachments;
@@ -34,8 +112,8 @@ RenderPass::RenderPass(const RenderPassDesc& desc)
             .storeOp = image.store_op,
             .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
             .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-            .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-            .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            .initialLayout = image.initial_layout,
+            .finalLayout = image.final_layout,
         };
 
         VkAttachmentReference attachment_ref = {
@@ -56,8 +134,6 @@ RenderPass::RenderPass(const RenderPassDesc& desc)
         attachments.push_back(attachment);
         attachment_refs.push_back(attachment_ref);
         framebuffer_attachments.push_back(fb_attachment_image_info);
-
-        m_clear_values.push_back(image.clear_value);
     }
 
     VkSubpassDescription subpass = {
@@ -72,14 +148,25 @@ RenderPass::RenderPass(const RenderPassDesc& desc)
         .pPreserveAttachments = nullptr,
     };
 
+    // Orders attachment writes after those of the previous pass rendering
+    // into the same image, e.g. an offscreen target reused every frame
+    VkSubpassDependency dependency = {
+        .srcSubpass = VK_SUBPASS_EXTERNAL,
+        .dstSubpass = 0,
+        .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        .srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = attachment_access(desc.images),
+    };
+
     VkRenderPassCreateInfo rp_create_info = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
         .attachmentCount = static_cast<uint32_t>(attachments.size()),
         .pAttachments = attachments.data(),
         .subpassCount = 1,
         .pSubpasses = &subpass,
-        .dependencyCount = 0,
-        .pDependencies = nullptr,
+        .dependencyCount = 1,
+        .pDependencies = &dependency,
     };
 
     auto result = vkCreateRenderPass(m_device, &rp_create_info, nullptr, &m_render_pass);
@@ -107,12 +194,42 @@ RenderPass::RenderPass(const RenderPassDesc& desc)
     VK_ASSERT(result);
 }
 
-void RenderPass::begin_render_pass(VkCommandBuffer cmd, std::span<VkImageView> images)
+VkCommandBufferInheritanceInfo RenderPass::inheritance() const
 {
+    // Render pass and framebuffer are null with dynamic rendering
+    return {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+        .pNext = m_dynamic_rendering ? &m_rendering_inheritance : nullptr,
+        .renderPass = m_render_pass,
+        .subpass = 0,
+        .framebuffer = m_framebuffer,
+    };
+}
+
+void RenderPass::set_viewport(VkCommandBuffer cmd) const
+{
+    vkCmdSetViewport(cmd, 0, 1, &m_viewport);
+    vkCmdSetScissor(cmd, 0, 1, &m_scissor);
+}
+
+void RenderPass::begin_render_pass(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets, VkSubpassContents contents)
+{
+    ASSERT(targets.size() == m_clear_values.size(), "Render pass needs one target per image");
+
+    if (m_dynamic_rendering) {
+        begin_rendering(cmd, targets, contents);
+        return;
+    }
+
+    std::vector<VkImageView> views;
+    for (auto target : targets) {
+        views.push_back(target.view);
+    }
+
     VkRenderPassAttachmentBeginInfo rp_attachment_begin_info = {
         .sType = VK_STRUCTURE_TYPE_RENDER_PASS_ATTACHMENT_BEGIN_INFO,
-        .attachmentCount = static_cast<uint32_t>(images.size()),
-        .pAttachments = images.data(),
+        .attachmentCount = static_cast<uint32_t>(views.size()),
+        .pAttachments = views.data(),
     };
 
     VkRenderPassBeginInfo rp_begin_info = {
@@ -128,13 +245,59 @@ void RenderPass::begin_render_pass(VkCommandBuffer cmd, std::span<VkImageView> i
         .pClearValues = m_clear_values.data(),
     };
 
-    vkCmdBeginRenderPass(cmd, &rp_begin_info, VK_SUBPASS_CONTENTS_INLINE);
-    vkCmdSetViewport(cmd, 0, 1, &m_viewport);
-    vkCmdSetScissor(cmd, 0, 1, &m_scissor);
+    vkCmdBeginRenderPass(cmd, &rp_begin_info, contents);
+
+    // Subpass with secondary command buffers may only execute them
+    if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+        set_viewport(cmd);
+    }
+}
+
+void RenderPass::end_render_pass(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets)
+{
+    if (!m_dynamic_rendering) {
+        vkCmdEndRenderPass(cmd);
+        return;
+    }
+
+    vkCmdEndRenderingKHR(cmd);
+
+    // Same as the implicit transition to the final layout at the end of a render pass
+    transition_targets(cmd, targets, m_images, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, false);
 }
 
-void RenderPass::end_render_pass(VkCommandBuffer cmd)
+void RenderPass::begin_rendering(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets, VkSubpassContents contents)
 {
-    vkCmdEndRenderPass(cmd);
+    // Takes the place of the subpass dependency and initial layout of a render pass
+    transition_targets(cmd, targets, m_images, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, attachment_access(m_images), true);
+
+    std::vector<VkRenderingAttachmentInfoKHR> attachments;
+    for (size_t i = 0; i < targets.size(); i++) {
+        attachments.push_back({
+            .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+            .imageView = targets[i].view,
+            .imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+            .resolveMode = VK_RESOLVE_MODE_NONE,
+            .loadOp = m_images[i].load_op,
+            .storeOp = m_images[i].store_op,
+            .clearValue = m_clear_values[i],
+        });
+    }
+
+    VkRenderingInfoKHR rendering_info = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+        .flags = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0u,
+        .renderArea = m_scissor,
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = static_cast<uint32_t>(attachments.size()),
+        .pColorAttachments = attachments.data(),
+    };
+
+    vkCmdBeginRenderingKHR(cmd, &rendering_info);
+
+    if (contents == VK_SUBPASS_CONTENTS_INLINE) {
+        set_viewport(cmd);
+    }
 }
 }
@@ -1,8 +1,10 @@
 #pragma once
 
+#include <Demo/CommandRecorder.h>
 #include <Demo/RendererBase.h>
 #include <optional>
 #include <span>
+#include <vector>
 
 namespace Demo {
 struct RenderPassImage {
@@ -10,12 +12,23 @@ struct RenderPassImage {
     VkAttachmentLoadOp load_op;
     VkAttachmentStoreOp store_op;
     VkClearValue clear_value;
+    // Loading from an undefined layout discards the contents
+    VkImageLayout initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 };
 
 struct RenderPassDesc {
     VkDevice device;
     Vector2u size;
     std::vector<RenderPassImage> images;
+    // Begins rendering with vkCmdBeginRenderingKHR, no render pass or framebuffer is created
+    bool dynamic_rendering = false;
+};
+
+// Dynamic rendering transitions the image itself, render pass objects only use the view
+struct RenderPassTarget {
+    VkImage image;
+    VkImageView view;
 };
 
 class RenderPass : NonCopyable {
@@ -32,13 +45,53 @@ public:
     }
 
     template<typename F>
-    void execute(VkCommandBuffer cmd, std::span<VkImageView> images, F f)
+    void execute(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets, F f)
     {
-        begin_render_pass(cmd, images);
+        begin_render_pass(cmd, targets, VK_SUBPASS_CONTENTS_INLINE);
         f();
-        end_render_pass(cmd);
+        end_render_pass(cmd, targets);
+    }
+
+    // Every draw range is recorded into its own secondary command buffer, f(cmd, i)
+    // may run on any thread of the job system. Ranges are executed in index order
+    template<typename F>
+    void execute(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets, CommandRecorder& recorder, uint32_t range_count, const F& f)
+    {
+        auto commands = record(recorder, range_count, f);
+        execute(cmd, targets, commands);
+    }
+
+    // Executes secondary command buffers recorded for this render pass in order
+    void execute(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets, std::span<const VkCommandBuffer> commands)
+    {
+        begin_render_pass(cmd, targets, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(cmd, static_cast<uint32_t>(commands.size()), commands.data());
+        end_render_pass(cmd, targets);
     }
 
+    // Secondary command buffers for execute(), valid for the current frame only
+    template<typename F>
+    std::vector<VkCommandBuffer> record(CommandRecorder& recorder, uint32_t range_count, const F& f) const
+    {
+        return recorder.record_secondary(range_count, inheritance(), [&](VkCommandBuffer secondary, uint32_t range) {
+            // Dynamic state isn't inherited from the primary command buffer
+            set_viewport(secondary);
+            f(secondary, range);
+        });
+    }
+
+    // Records a command buffer from CommandRecorder::allocate_reusable(), which stays valid
+    // for as long as this render pass does
+    template<typename F>
+    void record_reusable(CommandRecorder& recorder, VkCommandBuffer cmd, F f) const
+    {
+        recorder.record_reusable(cmd, inheritance(), [&](VkCommandBuffer secondary) {
+            set_viewport(secondary);
+            f(secondary);
+        });
+    }
+
+    // Null with dynamic rendering
     VkRenderPass raw() const { return m_render_pass; }
 
     RenderPass(RenderPass&& other) noexcept
@@ -51,13 +104,23 @@ public:
         swap(m_device, other.m_device);
         swap(m_framebuffer, other.m_framebuffer);
         swap(m_render_pass, other.m_render_pass);
+        swap(m_viewport, other.m_viewport);
+        swap(m_scissor, other.m_scissor);
+        swap(m_clear_values, other.m_clear_values);
         swap(m_size, other.m_size);
+        swap(m_dynamic_rendering, other.m_dynamic_rendering);
+        swap(m_images, other.m_images);
+        swap(m_formats, other.m_formats);
+        swap(m_rendering_inheritance, other.m_rendering_inheritance);
         return *this;
     }
 
 private:
-    void begin_render_pass(VkCommandBuffer cmd, std::span<VkImageView> images);
-    void end_render_pass(VkCommandBuffer cmd);
+    VkCommandBufferInheritanceInfo inheritance() const;
+    void set_viewport(VkCommandBuffer cmd) const;
+    void begin_render_pass(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets, VkSubpassContents contents);
+    void end_render_pass(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets);
+    void begin_rendering(VkCommandBuffer cmd, std::span<const RenderPassTarget> targets, VkSubpassContents contents);
 
     VkDevice m_device = VK_NULL_HANDLE;
     VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
@@ -66,5 +129,11 @@ private:
     VkRect2D m_scissor = {};
     std::vector<VkClearValue> m_clear_values = {};
     Vector2u m_size = {0, 0};
+
+    bool m_dynamic_rendering = false;
+    std::vector<RenderPassImage> m_images = {};
+    std::vector<VkFormat> m_formats = {};
+    // Chained into the inheritance info of secondary command buffers, points into m_formats
+    VkCommandBufferInheritanceRenderingInfoKHR m_rendering_inheritance = {};
 };
 }
@@ -0,0 +1,68 @@
+#include <Demo/RenderPassCache.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Demo {
+static bool same_image(const RenderPassImage& lhs, const RenderPassImage& rhs)
+{
+    // Clear value is a union, whichever member was written is compared bitwise
+    return lhs.format == rhs.format
+        && lhs.load_op == rhs.load_op
+        && lhs.store_op == rhs.store_op
+        && lhs.initial_layout == rhs.initial_layout
+        && lhs.final_layout == rhs.final_layout
+        && memcmp(&lhs.clear_value, &rhs.clear_value, sizeof(VkClearValue)) == 0;
+}
+
+static bool same_desc(const RenderPassDesc& lhs, const RenderPassDesc& rhs)
+{
+    return lhs.device == rhs.device
+        && lhs.size.width == rhs.size.width
+        && lhs.size.height == rhs.size.height
+        && lhs.dynamic_rendering == rhs.dynamic_rendering
+        && std::equal(lhs.images.begin(), lhs.images.end(), rhs.images.begin(), rhs.images.end(), same_image);
+}
+
+RenderPassCache::RenderPassCache(VkDevice device)
+{
+    m_device = device;
+}
+
+RenderPass& RenderPassCache::get(const RenderPassDesc& desc)
+{
+    // A renderer uses a handful of passes, so a linear search beats hashing the description
+    for (auto& entry : m_entries) {
+        if (same_desc(entry.desc, desc)) {
+            return *entry.render_pass;
+        }
+    }
+
+    m_entries.push_back({
+        .desc = desc,
+        .render_pass = std::make_unique<RenderPass>(desc),
+    });
+
+    return *m_entries.back().render_pass;
+}
+
+RenderPass& RenderPassCache::compatible(const std::vector<VkFormat>& formats)
+{
+    RenderPassDesc desc = {
+        .device = m_device,
+        .size = Vector2u(1, 1),
+    };
+
+    for (auto format : formats) {
+        desc.images.push_back({
+            .format = format,
+            .load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .clear_value = {},
+            .final_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        });
+    }
+
+    return get(desc);
+}
+}
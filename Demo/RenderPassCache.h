@@ -0,0 +1,49 @@
+#pragma once
+
+#include <Demo/RenderPass.h>
+
+#include <memory>
+#include <vector>
+
+namespace Demo {
+// Render passes and their imageless framebuffers keyed on the contents of their description.
+// References stay valid until clear(), so each distinct pass is created once
+class RenderPassCache : NonCopyable {
+public:
+    RenderPassCache() = default;
+    explicit RenderPassCache(VkDevice device);
+
+    // Created on first use
+    RenderPass& get(const RenderPassDesc& desc);
+
+    // Pipelines and the UI backend only need a pass whose attachments have the same formats.
+    // Always a render pass object, so raw() isn't null
+    RenderPass& compatible(const std::vector<VkFormat>& formats);
+
+    // Framebuffers have a fixed size, so passes are dropped when the render target is resized.
+    // None of them may be used by pending command buffers
+    void clear() { m_entries.clear(); }
+
+    RenderPassCache(RenderPassCache&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    RenderPassCache& operator=(RenderPassCache&& other) noexcept
+    {
+        swap(m_device, other.m_device);
+        swap(m_entries, other.m_entries);
+
+        return *this;
+    }
+
+private:
+    struct Entry {
+        RenderPassDesc desc;
+        std::unique_ptr<RenderPass> render_pass;
+    };
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    std::vector<Entry> m_entries = {};
+};
+}
@@ -1,36 +1,23 @@
 #include <Demo/Common/Base.h>
 #include <Demo/Common/Log.h>
+#include <Demo/Common/Trace.h>
 #include <Demo/Config.h>
 #include <Demo/Math.h>
 #include <Demo/Renderer.h>
 #include <Demo/Window.h>
-#include <GLFW/glfw3.h>
 
 #include <backends/imgui_impl_vulkan.h>
 
 #include <algorithm>
 #include <array>
 #include <fstream>
+#include <numeric>
 #include <span>
 #include <string_view>
+#include <utility>
 #include <vector>
 
 namespace Demo {
-static VkCommandPool create_command_pool(VkDevice device, uint32_t family_index)
-{
-    VkCommandPoolCreateInfo create_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
-        .flags = 0,
-        .queueFamilyIndex = family_index,
-    };
-
-    VkCommandPool pool = VK_NULL_HANDLE;
-    auto result = vkCreateCommandPool(device, &create_info, nullptr, &pool);
-    VK_ASSERT(result);
-
-    return pool;
-}
-
 static VmaAllocator create_allocator(VkInstance instance, VkPhysicalDevice physical_device, VkDevice device)
 {
     VmaVulkanFunctions vulkan_functions = {
@@ -113,103 +100,188 @@ static std::vector<uint8_t> load_binary_file(std::string_view path)
 }
 
 struct PushConstants {
-    float time;
+    uint32_t frame_index;
 };
 
-template<typename F>
-VkCommandBuffer record_command_buffer(VkDevice device, VkCommandPool pool, F f)
-{
-    VkCommandBufferAllocateInfo cmd_allocate_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
-        .commandPool = pool,
-        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-        .commandBufferCount = 1,
-    };
+struct MeshPushConstants {
+    Matrix4 view_projection;
+    MeshBounds bounds;
+};
 
-    VkCommandBuffer cmd = VK_NULL_HANDLE;
-    auto result = vkAllocateCommandBuffers(device, &cmd_allocate_info, &cmd);
-    VK_ASSERT(result);
+constexpr uint32_t ACCUMULATION_BINDING = 3;
+constexpr uint32_t OUTPUT_BINDING = 5;
 
-    VkCommandBufferBeginInfo cmd_begin_info = {
-        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-    };
+// Must match local size of pathtrace.comp
+constexpr uint32_t TILE_SIZE = 8;
 
-    VK_ASSERT(vkBeginCommandBuffer(cmd, &cmd_begin_info));
+// Resources touched by both the compute and graphics queues
+static std::vector<uint32_t> shared_queue_families(const QueueFamilies& queue_families)
+{
+    if (queue_families.graphics == queue_families.compute) {
+        return {queue_families.graphics};
+    }
 
-    f(cmd);
+    return {queue_families.graphics, queue_families.compute};
+}
 
-    VK_ASSERT(vkEndCommandBuffer(cmd));
+static void image_barrier(
+    VkCommandBuffer cmd,
+    VkImage image,
+    VkPipelineStageFlags src_stage,
+    VkAccessFlags src_access,
+    VkPipelineStageFlags dst_stage,
+    VkAccessFlags dst_access,
+    VkImageLayout old_layout,
+    VkImageLayout new_layout)
+{
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = src_access,
+        .dstAccessMask = dst_access,
+        .oldLayout = old_layout,
+        .newLayout = new_layout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = 0,
+            .levelCount = 1,
+            .baseArrayLayer = 0,
+            .layerCount = 1,
+        },
+    };
 
-    return cmd;
+    vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
 }
 
 Renderer::Renderer(const Window& window, GraphicsPass pass)
+    : Renderer(&window, window.size(), move(pass))
+{
+}
+
+Renderer::Renderer(Vector2u size, GraphicsPass pass)
+    : Renderer(nullptr, size, move(pass))
+{
+}
+
+Renderer::Renderer(const Window* window, Vector2u size, GraphicsPass pass)
     : RendererBase(window)
 {
-    m_size = window.size();
-    m_swapchain = Swapchain(m_surface, m_physical_device, m_queue_families, m_device, m_size);
-    m_command_pool = create_command_pool(m_device, m_queue_families.graphics);
+    m_size = size;
     m_allocator = create_allocator(m_instance, m_physical_device, m_device);
+    m_uploader = Uploader(m_device, m_allocator, m_queue_families, m_transfer, STAGING_BUFFER_SIZE);
 
-    m_rendering_finished = create_semaphore(m_device);
-    m_next_image_acquired = create_semaphore(m_device);
-    m_gpu_work_finished = create_fence(m_device, false);
+    if (headless()) {
+        m_render_target = Image(m_device, m_allocator, m_size, VK_FORMAT_B8G8R8A8_SRGB, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    } else {
+        m_swapchain = Swapchain(m_surface, m_physical_device, m_queue_families, m_device, m_size);
+    }
 
     m_descriptor_set_allocator = DescriptorSetAllocator(m_device);
 
-    std::vector<DescriptorBinding> bindings;
-    for (auto uniform_buffer : pass.uniform_buffers) {
-        Buffer buffer(m_allocator, uniform_buffer.buffer_size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        m_descriptor_set_buffers.push_back(move(buffer));
-
-        bindings.push_back({
-            .binding = uniform_buffer.binding,
-            .buffer_info = {
-                .buffer = m_descriptor_set_buffers.back().raw(),
-                .offset = 0,
-                .range = uniform_buffer.buffer_size,
-            },
-            .descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
-            .stages = VK_SHADER_STAGE_FRAGMENT_BIT,
-        });
-    }
-
+    // Storage buffers hold bulk scene data and are shared by all frames in flight
+    std::vector<DescriptorBinding> storage_bindings;
     for (auto storage_buffer : pass.storage_buffers) {
-        Buffer buffer(m_allocator, storage_buffer.buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
-        m_descriptor_set_buffers.push_back(move(buffer));
+        Buffer buffer(m_allocator, storage_buffer.buffer_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU, BufferFlags::Mapped);
+        m_storage_buffers.push_back(move(buffer));
 
-        bindings.push_back({
+        storage_bindings.push_back({
             .binding = storage_buffer.binding,
             .buffer_info = {
-                .buffer = m_descriptor_set_buffers.back().raw(),
+                .buffer = m_storage_buffers.back().raw(),
                 .offset = 0,
                 .range = storage_buffer.buffer_size,
             },
             .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-            .stages = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
         });
     }
 
-    m_descriptor_set = DescriptorSet(m_device, m_descriptor_set_allocator, bindings);
+    m_graphics_commands = CommandRecorder(m_device, m_queue_families.graphics);
+    m_compute_commands = CommandRecorder(m_device, m_queue_families.compute);
+
+    for (auto& frame : m_frames) {
+        frame.next_image_acquired = create_semaphore(m_device);
+        frame.compute_finished = create_semaphore(m_device);
+        frame.rendering_finished = create_semaphore(m_device);
+        frame.gpu_work_finished = create_fence(m_device, true);
+    }
+
+    create_storage_images();
+
+    m_profiler = GpuProfiler(m_device, m_physical_device, shared_queue_families(m_queue_families));
+
+    m_uniform_buffers = pass.uniform_buffers;
+    m_uniform_binding_order.resize(m_uniform_buffers.size());
+    std::iota(m_uniform_binding_order.begin(), m_uniform_binding_order.end(), 0);
+    std::sort(m_uniform_binding_order.begin(), m_uniform_binding_order.end(), [&](uint32_t lhs, uint32_t rhs) {
+        return m_uniform_buffers[lhs].binding < m_uniform_buffers[rhs].binding;
+    });
+
+    // Uniforms are rewritten every frame, so each frame in flight uploads them into its own arena
+    for (auto& frame : m_frames) {
+        frame.upload_arena = UploadArena(m_allocator, m_physical_device, UPLOAD_ARENA_SIZE);
+
+        std::vector<DescriptorBinding> bindings;
+        for (auto uniform_buffer : pass.uniform_buffers) {
+            bindings.push_back({
+                .binding = uniform_buffer.binding,
+                .buffer_info = {
+                    .buffer = frame.upload_arena.raw(),
+                    .offset = 0,
+                    .range = uniform_buffer.buffer_size,
+                },
+                .descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+                .stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+            });
+        }
+
+        bindings.insert(bindings.end(), storage_bindings.begin(), storage_bindings.end());
+        auto image_bindings = storage_image_bindings(frame);
+        bindings.insert(bindings.end(), image_bindings.begin(), image_bindings.end());
+        frame.descriptor_set = DescriptorSet(m_device, m_descriptor_set_allocator, bindings);
+    }
+
+    m_snapshots.resize(pass.uniform_buffers.size() + pass.storage_buffers.size());
+
+    m_pipeline_cache = PipelineCache(m_device, m_physical_device, PIPELINE_CACHE_PATH);
+    m_render_passes = RenderPassCache(m_device);
 
     auto mesh_vertex_spirv = load_binary_file("../Demo/Shaders/mesh.vert.spv");
     auto mesh_fragment_spirv = load_binary_file("../Demo/Shaders/mesh.frag.spv");
     auto vertex_spirv = load_binary_file("../Demo/Shaders/fullscreen.vert.spv");
     auto fragment_spirv = load_binary_file("../Demo/Shaders/fullscreen.frag.spv");
+    auto path_tracer_spirv = load_binary_file("../Demo/Shaders/pathtrace.comp.spv");
 
-    m_pipeline = GraphicsPipeline({
+    m_path_tracer = ComputePipeline({
         .device = m_device,
+        .pipeline_cache = m_pipeline_cache.raw(),
         .descriptor_set_layouts = {
-            m_descriptor_set.layout(),
+            m_frames[0].descriptor_set.layout(),
         },
         .push_constant_ranges = {
             {
-                .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
                 .offset = 0,
                 .size = sizeof(PushConstants),
             },
         },
+        .compute_shader = Shader(m_device, path_tracer_spirv),
+        .specialization_constants = {
+            {.id = 0, .value = SAMPLES_PER_FRAME},
+            {.id = 1, .value = MAX_BOUNCES},
+        },
+    });
+
+    m_pipeline = GraphicsPipeline({
+        .device = m_device,
+        .pipeline_cache = m_pipeline_cache.raw(),
+        .render_pass_cache = &m_render_passes,
+        .dynamic_rendering = dynamic_rendering(),
+        .descriptor_set_layouts = {
+            m_frames[0].descriptor_set.layout(),
+        },
         .vertex_shader = Shader(m_device, vertex_spirv),
         .fragment_shader = Shader(m_device, fragment_spirv),
         .images = {VK_FORMAT_B8G8R8A8_SRGB},
@@ -217,12 +289,38 @@ Renderer::Renderer(const Window& window, GraphicsPass pass)
 
     m_mesh_pipeline = GraphicsPipeline({
         .device = m_device,
-        .vertex_layout = Vertex::layout(),
+        .pipeline_cache = m_pipeline_cache.raw(),
+        .render_pass_cache = &m_render_passes,
+        .dynamic_rendering = dynamic_rendering(),
+        .vertex_layout = Vertex::layout(MESH_VERTEX_FORMAT),
+        .push_constant_ranges = {
+            {
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                .offset = 0,
+                .size = sizeof(MeshPushConstants),
+            },
+        },
+        // Imported meshes wind counter-clockwise, which the flipped Y of Matrix4::perspective keeps
+        .cull_mode = VK_CULL_MODE_BACK_BIT,
+        .front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE,
         .vertex_shader = Shader(m_device, mesh_vertex_spirv),
         .fragment_shader = Shader(m_device, mesh_fragment_spirv),
         .images = {VK_FORMAT_B8G8R8A8_SRGB},
+        .specialization_constants = {
+            {.id = 0, .value = MESH_VERTEX_FORMAT == VertexFormat::Packed},
+        },
     });
 
+    // There is no UI to draw in headless mode
+    if (!headless()) {
+        init_imgui();
+    }
+
+    wait_for_frame(m_frame_index);
+}
+
+void Renderer::init_imgui()
+{
     ImGui_ImplVulkan_LoadFunctions([](const char* function_name, void* user_data) {
         return vkGetInstanceProcAddr((VkInstance)user_data, function_name);
     },
@@ -234,60 +332,178 @@ Renderer::Renderer(const Window& window, GraphicsPass pass)
     init_info.Device = m_device;
     init_info.QueueFamily = m_queue_families.graphics;
     init_info.Queue = m_graphics;
-    init_info.PipelineCache = VK_NULL_HANDLE;
+    init_info.PipelineCache = m_pipeline_cache.raw();
     init_info.DescriptorPool = m_descriptor_set_allocator.pool();
     init_info.Allocator = nullptr;
     init_info.MinImageCount = 2;
-    init_info.ImageCount = 2;
+    init_info.ImageCount = std::max(FRAMES_IN_FLIGHT, 2u);
     init_info.CheckVkResultFn = [](VkResult result) {
         VK_ASSERT(result);
     };
 
-    RenderPass rp(RenderPassDesc{
+    // Pipeline of the backend is created here, it doesn't keep using the render pass
+    ImGui_ImplVulkan_Init(&init_info, m_render_passes.compatible({VK_FORMAT_B8G8R8A8_SRGB}).raw());
+
+    submit_immediately([](VkCommandBuffer cmd) {
+        ImGui_ImplVulkan_CreateFontsTexture(cmd);
+    });
+
+    ImGui_ImplVulkan_DestroyFontUploadObjects();
+}
+
+template<typename F>
+void Renderer::submit_immediately(F f)
+{
+    // Command buffer is freed once the current frame slot is reused
+    auto cmd = m_graphics_commands.record(f);
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmd,
+    };
+
+    VK_ASSERT(vkQueueSubmit(m_graphics, 1, &submit_info, VK_NULL_HANDLE));
+    VK_ASSERT(vkQueueWaitIdle(m_graphics));
+}
+
+void Renderer::create_storage_images()
+{
+    auto families = shared_queue_families(m_queue_families);
+
+    m_accumulation = Image(m_device, m_allocator, m_size, VK_FORMAT_R32G32B32A32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, families);
+    m_accumulated_frames = 0;
+
+    for (auto& frame : m_frames) {
+        frame.output = Image(m_device, m_allocator, m_size, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT, families);
+    }
+
+    // Storage images stay in the general layout for their whole lifetime
+    submit_immediately([&](VkCommandBuffer cmd) {
+        auto transition = [&](const Image& image) {
+            image_barrier(
+                cmd,
+                image.raw(),
+                VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                0,
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                VK_IMAGE_LAYOUT_UNDEFINED,
+                VK_IMAGE_LAYOUT_GENERAL);
+        };
+
+        transition(m_accumulation);
+        for (auto& frame : m_frames) {
+            transition(frame.output);
+        }
+    });
+}
+
+// Composite leaves the image in the attachment layout when the UI is drawn by a pass of its own
+RenderPassDesc Renderer::composite_pass_desc(bool ui_pass) const
+{
+    auto final_layout = headless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    return {
         .device = m_device,
-        .size = Vector2u(1, 1),
+        .size = m_size,
         .images = {
             RenderPassImage{
                 .format = VK_FORMAT_B8G8R8A8_SRGB,
-                .load_op = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
-                .store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                .clear_value = VkClearValue{.color = {0.5f, 0.7f, 0.9f, 1.0f}},
+                .final_layout = ui_pass ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : final_layout,
             },
         },
-    });
-
-    ImGui_ImplVulkan_Init(&init_info, rp.raw());
+        .dynamic_rendering = dynamic_rendering(),
+    };
+}
 
-    {
-        auto cmd = record_command_buffer(m_device, m_command_pool, [](auto cmd) {
-            ImGui_ImplVulkan_CreateFontsTexture(cmd);
-        });
+// ImGui's backend only creates its pipeline for a render pass object
+RenderPassDesc Renderer::ui_pass_desc() const
+{
+    return {
+        .device = m_device,
+        .size = m_size,
+        .images = {
+            RenderPassImage{
+                .format = VK_FORMAT_B8G8R8A8_SRGB,
+                .load_op = VK_ATTACHMENT_LOAD_OP_LOAD,
+                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                .clear_value = {},
+                .initial_layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                .final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+            },
+        },
+    };
+}
 
-        VkSubmitInfo end_info = {};
-        end_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        end_info.commandBufferCount = 1;
-        end_info.pCommandBuffers = &cmd;
-        VK_ASSERT(vkQueueSubmit(m_graphics, 1, &end_info, VK_NULL_HANDLE));
-        VK_ASSERT(vkDeviceWaitIdle(m_device));
-        ImGui_ImplVulkan_DestroyFontUploadObjects();
-    }
+std::vector<DescriptorBinding> Renderer::storage_image_bindings(const Frame& frame) const
+{
+    return {
+        DescriptorBinding{
+            .binding = ACCUMULATION_BINDING,
+            .image_info = {
+                .sampler = VK_NULL_HANDLE,
+                .imageView = m_accumulation.view(),
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            },
+            .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .stages = VK_SHADER_STAGE_COMPUTE_BIT,
+        },
+        DescriptorBinding{
+            .binding = OUTPUT_BINDING,
+            .image_info = {
+                .sampler = VK_NULL_HANDLE,
+                .imageView = frame.output.view(),
+                .imageLayout = VK_IMAGE_LAYOUT_GENERAL,
+            },
+            .descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .stages = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        },
+    };
 }
 
 Renderer::~Renderer()
 {
     if (m_device) {
-        ImGui_ImplVulkan_Shutdown();
+        vkDeviceWaitIdle(m_device);
+
+        if (!headless()) {
+            ImGui_ImplVulkan_Shutdown();
+        }
+
         dispose(m_mesh_pipeline);
         dispose(m_pipeline);
-        dispose(m_descriptor_set);
-        dispose(m_descriptor_set_allocator);
-        dispose(m_descriptor_set_buffers);
+        dispose(m_path_tracer);
+        dispose(m_render_passes);
+
+        m_pipeline_cache.save();
+        dispose(m_pipeline_cache);
+        dispose(m_profiler);
+
+        for (auto& frame : m_frames) {
+            dispose(frame.output);
+            dispose(frame.descriptor_set);
+            dispose(frame.upload_arena);
 
-        vkDestroyFence(m_device, m_gpu_work_finished, nullptr);
-        vkDestroySemaphore(m_device, m_next_image_acquired, nullptr);
-        vkDestroySemaphore(m_device, m_rendering_finished, nullptr);
+            vkDestroyFence(m_device, frame.gpu_work_finished, nullptr);
+            vkDestroySemaphore(m_device, frame.rendering_finished, nullptr);
+            vkDestroySemaphore(m_device, frame.compute_finished, nullptr);
+            vkDestroySemaphore(m_device, frame.next_image_acquired, nullptr);
+        }
 
+        dispose(m_compute_commands);
+        dispose(m_graphics_commands);
+
+        dispose(m_storage_buffers);
+        dispose(m_descriptor_set_allocator);
+
+        dispose(m_accumulation);
+        dispose(m_render_target);
+        dispose(m_uploader);
         vmaDestroyAllocator(m_allocator);
-        vkDestroyCommandPool(m_device, m_command_pool, nullptr);
 
         dispose(m_swapchain);
     }
@@ -299,82 +515,397 @@ void Renderer::resize(Vector2u size)
     m_size = size;
 
     if (size.rectangle_area() > 0) {
-        dispose(m_swapchain);
-        m_swapchain = Swapchain(m_surface, m_physical_device, m_queue_families, m_device, m_size);
+        if (headless()) {
+            dispose(m_render_target);
+            m_render_target = Image(m_device, m_allocator, m_size, VK_FORMAT_B8G8R8A8_SRGB, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+            m_render_target_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        } else {
+            dispose(m_swapchain);
+            m_swapchain = Swapchain(m_surface, m_physical_device, m_queue_families, m_device, m_size);
+        }
+
+        dispose(m_accumulation);
+        for (auto& frame : m_frames) {
+            dispose(frame.output);
+        }
+
+        create_storage_images();
+
+        for (auto& frame : m_frames) {
+            frame.descriptor_set.write(storage_image_bindings(frame));
+        }
+
+        // Recorded commands refer to old render passes and storage images
+        m_render_passes.clear();
+        for (auto& frame : m_frames) {
+            frame.composite_recorded = false;
+        }
     }
 }
 
 void Renderer::render()
 {
+    // Mesh draws are requested for one frame only
+    auto mesh_draws = std::exchange(m_mesh_draws, {});
+    std::erase_if(mesh_draws, [&](const MeshDraw& draw) {
+        return !is_uploaded(*draw.mesh);
+    });
+
     // Skip rendering when the window is minimized
     if (m_size.rectangle_area() == 0) {
         return;
     }
 
-    auto [view, index] = m_swapchain.acquire_next_image(m_next_image_acquired);
+    TRACE_ZONE("Render");
 
-    RenderPass render_pass({
-        .device = m_device,
-        .size = m_size,
-        .images = {
-            RenderPassImage{
-                .format = VK_FORMAT_B8G8R8A8_SRGB,
-                .load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
-                .store_op = VK_ATTACHMENT_STORE_OP_STORE,
-                .clear_value = VkClearValue{.color = {0.5f, 0.7f, 0.9f, 1.0f}},
-            },
-        },
-    });
+    // Meshes created since the last frame start uploading in parallel with it
+    m_uploader.submit();
+
+    auto& frame = m_frames[m_frame_index];
+    auto [view, index] = [&] {
+        TRACE_ZONE("Acquire");
+        return headless()
+            ? std::pair(m_render_target.view(), 0u)
+            : m_swapchain.acquire_next_image(frame.next_image_acquired);
+    }();
+    auto image = headless() ? m_render_target.raw() : m_swapchain.image(index);
 
     PushConstants push_constants = {
-        .time = static_cast<float>(glfwGetTime()),
+        .frame_index = m_accumulated_frames,
     };
 
-    ImGui::Render();
-    ImDrawData* draw_data = ImGui::GetDrawData();
-
-    std::array image_views = {view};
-    auto cmd = record_command_buffer(m_device, m_command_pool, [&](auto cmd) {
-        render_pass.execute(cmd, image_views, [&]() {
-            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.raw());
-            vkCmdPushConstants(cmd, m_pipeline.layout(), VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &push_constants);
-            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.layout(), 0, 1, m_descriptor_set.as_ptr(), 0, nullptr);
-            vkCmdDraw(cmd, 3, 1, 0, 0);
+    ImDrawData* draw_data = nullptr;
+    if (!headless()) {
+        ImGui::Render();
+        draw_data = ImGui::GetDrawData();
+    }
 
-            ImGui_ImplVulkan_RenderDrawData(draw_data, cmd);
+    auto dynamic_offsets = upload_uniforms(frame);
+    frame.upload_arena.flush();
+
+    auto compute_cmd = m_compute_commands.record([&](VkCommandBuffer cmd) {
+        TRACE_ZONE("Record compute");
+
+        // Previous frame may still be accumulating into the same image. Output image of
+        // this frame was last read by the composite pass, which the frame fence waited for
+        image_barrier(
+            cmd,
+            m_accumulation.raw(),
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL,
+            VK_IMAGE_LAYOUT_GENERAL);
+
+        m_profiler.scope(cmd, m_queue_families.compute, "Path trace", [&]() {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_path_tracer.raw());
+            vkCmdPushConstants(cmd, m_path_tracer.layout(), VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants), &push_constants);
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_path_tracer.layout(), 0, 1, frame.descriptor_set.as_ptr(), static_cast<uint32_t>(dynamic_offsets.size()), dynamic_offsets.data());
+            vkCmdDispatch(cmd, (m_size.width + TILE_SIZE - 1) / TILE_SIZE, (m_size.height + TILE_SIZE - 1) / TILE_SIZE, 1);
         });
+
+        // Waiting for the frame doesn't make shader writes to storage buffers visible to read()
+        VkMemoryBarrier host_barrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+        };
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &host_barrier, 0, nullptr, 0, nullptr);
     });
 
-    VkPipelineStageFlags stage_mask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    VkSubmitInfo submit_info = {
+    VkSubmitInfo compute_submit_info = {
         .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &m_next_image_acquired,
-        .pWaitDstStageMask = &stage_mask,
         .commandBufferCount = 1,
-        .pCommandBuffers = &cmd,
+        .pCommandBuffers = &compute_cmd,
         .signalSemaphoreCount = 1,
-        .pSignalSemaphores = &m_rendering_finished,
+        .pSignalSemaphores = &frame.compute_finished,
     };
 
-    VK_ASSERT(vkQueueSubmit(m_graphics, 1, &submit_info, m_gpu_work_finished));
+    frame.submit_time = trace_now();
+    {
+        TRACE_ZONE("Submit compute");
+        VK_ASSERT(vkQueueSubmit(m_compute, 1, &compute_submit_info, VK_NULL_HANDLE));
+    }
 
-    VkPresentInfoKHR present_info = {
-        .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-        .waitSemaphoreCount = 1,
-        .pWaitSemaphores = &m_rendering_finished,
-        .swapchainCount = 1,
-        .pSwapchains = m_swapchain.as_ptr(),
-        .pImageIndices = &index,
-        .pResults = nullptr,
+    // UI can't be drawn inside dynamic rendering, so it follows the composite in a render pass object
+    bool ui_pass = draw_data && dynamic_rendering();
+    auto& render_pass = m_render_passes.get(composite_pass_desc(ui_pass));
+    auto& ui_render_pass = ui_pass ? m_render_passes.get(ui_pass_desc()) : render_pass;
+    std::array targets = {RenderPassTarget{image, view}};
+    auto graphics_cmd = m_graphics_commands.record([&](VkCommandBuffer cmd) {
+        TRACE_ZONE("Record graphics");
+
+        std::vector<VkCommandBuffer> commands = {composite_commands(frame, render_pass, dynamic_offsets)};
+        std::vector<VkCommandBuffer> ui_commands;
+
+        // Meshes are rasterized over the path traced image, every draw is a range of its own
+        if (!mesh_draws.empty()) {
+            auto mesh_commands = render_pass.record(m_graphics_commands, static_cast<uint32_t>(mesh_draws.size()), [&](VkCommandBuffer secondary, uint32_t range) {
+                auto& draw = mesh_draws[range];
+                MeshPushConstants mesh_push_constants = {
+                    .view_projection = draw.view_projection,
+                    .bounds = draw.mesh->bounds(),
+                };
+
+                vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, m_mesh_pipeline.raw());
+                vkCmdPushConstants(secondary, m_mesh_pipeline.layout(), VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &mesh_push_constants);
+                draw.mesh->draw(secondary);
+            });
+
+            commands.insert(commands.end(), mesh_commands.begin(), mesh_commands.end());
+        }
+
+        // UI changes every frame, it's drawn on top of the composite
+        if (draw_data) {
+            ui_commands = ui_render_pass.record(m_graphics_commands, 1, [&](VkCommandBuffer secondary, uint32_t) {
+                TRACE_ZONE("Record UI");
+                m_profiler.scope(secondary, m_queue_families.graphics, "ImGui", [&]() {
+                    ImGui_ImplVulkan_RenderDrawData(draw_data, secondary);
+                });
+            });
+        }
+
+        if (!ui_pass) {
+            commands.insert(commands.end(), ui_commands.begin(), ui_commands.end());
+        }
+
+        m_profiler.scope(cmd, m_queue_families.graphics, "Render pass", [&]() {
+            render_pass.execute(cmd, targets, commands);
+            if (ui_pass) {
+                ui_render_pass.execute(cmd, targets, ui_commands);
+            }
+        });
+    });
+
+    // Offscreen target doesn't have to be acquired or presented
+    std::array wait_semaphores = {frame.compute_finished, frame.next_image_acquired};
+    std::array<VkPipelineStageFlags, 2> wait_stages = {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    uint32_t wait_semaphore_count = headless() ? 1 : 2;
+    uint32_t signal_semaphore_count = headless() ? 0 : 1;
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .waitSemaphoreCount = wait_semaphore_count,
+        .pWaitSemaphores = wait_semaphores.data(),
+        .pWaitDstStageMask = wait_stages.data(),
+        .commandBufferCount = 1,
+        .pCommandBuffers = &graphics_cmd,
+        .signalSemaphoreCount = signal_semaphore_count,
+        .pSignalSemaphores = &frame.rendering_finished,
     };
 
-    VK_ASSERT(vkQueuePresentKHR(m_present, &present_info));
+    frame.graphics_submit_time = trace_now();
+    {
+        TRACE_ZONE("Submit graphics");
+        VK_ASSERT(vkQueueSubmit(m_graphics, 1, &submit_info, frame.gpu_work_finished));
+    }
+    m_accumulated_frames++;
+
+    if (headless()) {
+        m_render_target_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    } else {
+        VkPresentInfoKHR present_info = {
+            .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+            .waitSemaphoreCount = 1,
+            .pWaitSemaphores = &frame.rendering_finished,
+            .swapchainCount = 1,
+            .pSwapchains = m_swapchain.as_ptr(),
+            .pImageIndices = &index,
+            .pResults = nullptr,
+        };
+
+        TRACE_ZONE("Present");
+        VK_ASSERT(vkQueuePresentKHR(m_present, &present_info));
+    }
+
+    // Only block if GPU is more than FRAMES_IN_FLIGHT frames behind. Waiting here
+    // rather than at the beginning of render() makes uniform updates safe
+    m_frame_index = (m_frame_index + 1) % FRAMES_IN_FLIGHT;
+    wait_for_frame(m_frame_index);
+    m_profiler.begin_frame(m_frame_index);
+    trace_completed_frame(m_frames[m_frame_index]);
+}
+
+void Renderer::wait_idle()
+{
+    VK_ASSERT(vkDeviceWaitIdle(m_device));
+}
+
+GPUMesh Renderer::create_mesh(const Mesh& mesh)
+{
+    return GPUMesh(m_allocator, m_uploader, mesh, MESH_VERTEX_FORMAT);
+}
+
+GPUMesh Renderer::create_mesh(const MeshCache& cache)
+{
+    ASSERT(cache.format() == MESH_VERTEX_FORMAT, "Mesh cache was written for another vertex format");
+    return GPUMesh(m_allocator, m_uploader, cache);
+}
+
+VkCommandBuffer Renderer::composite_commands(Frame& frame, const RenderPass& render_pass, const std::vector<uint32_t>& dynamic_offsets)
+{
+    // Render pass only changes on resize, which resets the flag, and the composite pass followed by
+    // a UI pass is compatible with the one that isn't. Uniforms are allocated first from an arena
+    // that is reset every frame, so their offsets only change if it was used differently
+    if (frame.composite_recorded && frame.composite_offsets == dynamic_offsets) {
+        return frame.composite_commands;
+    }
+
+    TRACE_ZONE("Record composite");
+
+    if (!frame.composite_commands) {
+        frame.composite_commands = m_graphics_commands.allocate_reusable();
+    }
+
+    // Frame's fence was waited for, so the previous recording isn't pending anymore
+    render_pass.record_reusable(m_graphics_commands, frame.composite_commands, [&](VkCommandBuffer cmd) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.raw());
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline.layout(), 0, 1, frame.descriptor_set.as_ptr(), static_cast<uint32_t>(dynamic_offsets.size()), dynamic_offsets.data());
+        vkCmdDraw(cmd, 3, 1, 0, 0);
+    });
+
+    frame.composite_offsets = dynamic_offsets;
+    frame.composite_recorded = true;
+
+    return frame.composite_commands;
+}
+
+void Renderer::wait_for_frame(uint32_t frame_index)
+{
+    auto& frame = m_frames[frame_index];
+    {
+        TRACE_ZONE("Fence wait");
+        VK_ASSERT(vkWaitForFences(m_device, 1, &frame.gpu_work_finished, VK_TRUE, TIMEOUT));
+    }
+    vkResetFences(m_device, 1, &frame.gpu_work_finished);
+
+    // Graphics work of the frame waited for its compute work, so both are finished
+    m_graphics_commands.begin_frame(frame_index);
+    m_compute_commands.begin_frame(frame_index);
+
+    frame.upload_arena.reset();
+}
+
+void Renderer::trace_completed_frame(Frame& frame)
+{
+    if (frame.submit_time == 0) {
+        return;
+    }
+
+    // Completion is when the fence wait returned, which may be later than when the GPU finished.
+    // GPU scopes can't start before the submit to their queue, so they are placed relative to it.
+    // Compute is submitted first, so it's the base of both if they share a queue family
+    trace_gpu("Frame", frame.submit_time, trace_now());
+    for (auto& scope : m_profiler.last_frame()) {
+        auto submit_time = scope.queue_family == m_queue_families.compute ? frame.submit_time : frame.graphics_submit_time;
+        trace_gpu(scope.name, submit_time + scope.begin, submit_time + scope.end);
+    }
+
+    frame.submit_time = 0;
+}
+
+std::vector<uint32_t> Renderer::upload_uniforms(Frame& frame)
+{
+    std::vector<uint32_t> dynamic_offsets;
+
+    for (auto index : m_uniform_binding_order) {
+        const auto& snapshot = m_snapshots[index];
+        auto size = m_uniform_buffers[index].buffer_size;
+
+        ASSERT(snapshot.size() <= size, "Uniform data doesn't fit into its buffer");
+
+        // Whole descriptor range must be backed even if update() was never called
+        auto slice = frame.upload_arena.allocate_uniform(size);
+        memset(slice.data, 0, size);
+        memcpy(slice.data, snapshot.data(), snapshot.size());
+
+        dynamic_offsets.push_back(static_cast<uint32_t>(slice.offset));
+    }
+
+    return dynamic_offsets;
+}
+
+void Renderer::write(uint32_t index, const void* data, size_t size)
+{
+    ASSERT(index >= m_uniform_buffers.size(), "Uniforms are snapshotted, only storage buffers can be written");
+    auto& buffer = m_storage_buffers[index - m_uniform_buffers.size()];
+    ASSERT(size <= buffer.size(), "Storage data doesn't fit into its buffer");
+
+    // Storage buffers are shared between frames, so none of them may be in flight
+    vkDeviceWaitIdle(m_device);
+    buffer.write(data, size);
+}
+
+void Renderer::read(uint32_t index, void* data, size_t size)
+{
+    ASSERT(index >= m_uniform_buffers.size(), "Only storage buffers can be read");
+    auto& buffer = m_storage_buffers[index - m_uniform_buffers.size()];
+    ASSERT(size <= buffer.size(), "Storage data doesn't fit into its buffer");
+
+    // Frames in flight may still be writing the buffer
+    VK_ASSERT(vkDeviceWaitIdle(m_device));
+    buffer.invalidate();
+    memcpy(data, buffer.mapped_data(), size);
+}
+
+std::vector<uint8_t> Renderer::read_back()
+{
+    ASSERT(headless(), "Only offscreen render target can be read back");
+
+    // All frames in flight must finish before the target contains the last one
+    VK_ASSERT(vkDeviceWaitIdle(m_device));
+
+    auto size = static_cast<size_t>(m_size.rectangle_area()) * 4;
+    Buffer buffer(m_allocator, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU, BufferFlags::Mapped);
+
+    submit_immediately([&](VkCommandBuffer cmd) {
+        image_barrier(
+            cmd,
+            m_render_target.raw(),
+            VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_PIPELINE_STAGE_TRANSFER_BIT,
+            VK_ACCESS_TRANSFER_READ_BIT,
+            m_render_target_layout,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+
+        VkBufferImageCopy region = {
+            .bufferOffset = 0,
+            .bufferRowLength = 0,
+            .bufferImageHeight = 0,
+            .imageSubresource = {
+                .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel = 0,
+                .baseArrayLayer = 0,
+                .layerCount = 1,
+            },
+            .imageOffset = {0, 0, 0},
+            .imageExtent = {m_size.width, m_size.height, 1},
+        };
+
+        vkCmdCopyImageToBuffer(cmd, m_render_target.raw(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer.raw(), 1, &region);
+
+        VkBufferMemoryBarrier buffer_barrier = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .buffer = buffer.raw(),
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &buffer_barrier, 0, nullptr);
+    });
+
+    buffer.invalidate();
 
-    VK_ASSERT(vkWaitForFences(m_device, 1, &m_gpu_work_finished, VK_TRUE, TIMEOUT));
-    vkResetFences(m_device, 1, &m_gpu_work_finished);
+    std::vector<uint8_t> pixels(size);
+    memcpy(pixels.data(), buffer.mapped_data(), size);
 
-    vkFreeCommandBuffers(m_device, m_command_pool, 1, &cmd);
-    vkResetCommandPool(m_device, m_command_pool, 0);
+    return pixels;
 }
 }
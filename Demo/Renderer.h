@@ -1,20 +1,34 @@
 #pragma once
 
 #include <Demo/Buffer.h>
+#include <Demo/CommandRecorder.h>
 #include <Demo/Common/Base.h>
 #include <Demo/Common/Types.h>
+#include <Demo/Config.h>
 #include <Demo/Descriptor.h>
+#include <Demo/GpuProfiler.h>
+#include <Demo/Image.h>
 #include <Demo/Mesh.h>
+#include <Demo/MeshCache.h>
 #include <Demo/Pipeline.h>
+#include <Demo/PipelineCache.h>
 #include <Demo/RenderPass.h>
+#include <Demo/RenderPassCache.h>
 #include <Demo/RendererBase.h>
 #include <Demo/Swapchain.h>
+#include <Demo/UploadArena.h>
 #include <Demo/Window.h>
+#include <array>
+#include <cstring>
 #include <span>
 #include <vector>
 #include <vk_mem_alloc.h>
 
 namespace Demo {
+// Halves vertex fetch bandwidth, the mesh pipeline is specialized to decode it.
+// Mesh caches uploaded with create_mesh() must be written in this format
+constexpr VertexFormat MESH_VERTEX_FORMAT = VertexFormat::Packed;
+
 struct UniformBuffer {
     uint32_t binding;
     size_t buffer_size;
@@ -28,33 +42,152 @@ struct GraphicsPass {
 class Renderer : public RendererBase {
 public:
     Renderer(const Window& window, GraphicsPass pass);
+
+    // Headless renderer draws into an offscreen image instead of a swapchain
+    Renderer(Vector2u size, GraphicsPass pass);
     ~Renderer();
     void render();
     void resize(Vector2u size);
 
+    // Copies the last rendered frame to host memory as tightly packed BGRA8 pixels
+    std::vector<uint8_t> read_back();
+
+    // Number of frames accumulated since the scene or camera last changed
+    uint32_t accumulated_frames() const { return m_accumulated_frames; }
+
+    // GPU time of the path trace pass, the render pass and the UI inside it
+    const GpuProfiler& profiler() const { return m_profiler; }
+    GpuProfiler& profiler() { return m_profiler; }
+
+    // Transient per-draw data for the frame being recorded
+    UploadArena& upload_arena() { return m_frames[m_frame_index].upload_arena; }
+
+    // Upload is submitted with the next frame at the latest
+    GPUMesh create_mesh(const Mesh& mesh);
+    GPUMesh create_mesh(const MeshCache& cache);
+
+    // Meshes may be destroyed once their uploads and the frames drawing them have finished
+    void wait_idle();
+    bool is_uploaded(const GPUMesh& mesh) { return m_uploader.is_complete(mesh.upload_ticket()); }
+
+    // Rasterizes the mesh over the path traced image of the next render(), which skips
+    // meshes that are still uploading. Mesh must stay alive until that frame has finished
+    void draw_mesh(const GPUMesh& mesh, const Matrix4& view_projection) { m_mesh_draws.push_back({&mesh, view_projection}); }
+
+    // Uniforms are uploaded into the upload arena when the frame is rendered
     template<typename T>
     void update(uint32_t index, T t)
     {
-        m_descriptor_set_buffers[index].map([&](auto* ptr) {
-            memcpy(ptr, &t, sizeof(T));
-        });
+        // Samples accumulated so far are only valid for unchanged uniforms and scene
+        auto& snapshot = m_snapshots[index];
+        auto* bytes = reinterpret_cast<const uint8_t*>(&t);
+        if (snapshot.size() != sizeof(T) || memcmp(snapshot.data(), bytes, sizeof(T)) != 0) {
+            snapshot.assign(bytes, bytes + sizeof(T));
+            m_accumulated_frames = 0;
+        }
+
+        if (index >= m_uniform_buffers.size()) {
+            write(index, &t, sizeof(T));
+        }
+    }
+
+    // Arrays such as scene geometry are too large to snapshot, so they always restart accumulation
+    template<typename T>
+    void update(uint32_t index, const std::vector<T>& data)
+    {
+        m_accumulated_frames = 0;
+        write(index, data.data(), data.size() * sizeof(T));
+    }
+
+    // Waits for all frames in flight, so it's meant for results such as counters read once
+    template<typename T>
+    T read(uint32_t index)
+    {
+        T t;
+        read(index, &t, sizeof(T));
+        return t;
     }
 
 private:
+    struct MeshDraw {
+        const GPUMesh* mesh;
+        Matrix4 view_projection;
+    };
+
+    struct Frame {
+        VkSemaphore next_image_acquired = VK_NULL_HANDLE;
+        VkSemaphore compute_finished = VK_NULL_HANDLE;
+        VkSemaphore rendering_finished = VK_NULL_HANDLE;
+        VkFence gpu_work_finished = VK_NULL_HANDLE;
+
+        DescriptorSet descriptor_set = {};
+        UploadArena upload_arena = {};
+
+        // Path traced by the compute queue and composited by the graphics queue
+        Image output = {};
+
+        // CPU time of the compute submit, zero once the frame was traced as completed
+        uint64_t submit_time = 0;
+        uint64_t graphics_submit_time = 0;
+
+        // Composite pass only changes with the render pass, the descriptor set or the uniform
+        // offsets, so it's recorded once and replayed
+        VkCommandBuffer composite_commands = VK_NULL_HANDLE;
+        std::vector<uint32_t> composite_offsets = {};
+        bool composite_recorded = false;
+    };
+
+    Renderer(const Window* window, Vector2u size, GraphicsPass pass);
+    void init_imgui();
+    void create_storage_images();
+    RenderPassDesc composite_pass_desc(bool ui_pass) const;
+    RenderPassDesc ui_pass_desc() const;
+    VkCommandBuffer composite_commands(Frame& frame, const RenderPass& render_pass, const std::vector<uint32_t>& dynamic_offsets);
+    std::vector<DescriptorBinding> storage_image_bindings(const Frame& frame) const;
+    void wait_for_frame(uint32_t frame_index);
+    void trace_completed_frame(Frame& frame);
+    void write(uint32_t index, const void* data, size_t size);
+    void read(uint32_t index, void* data, size_t size);
+    std::vector<uint32_t> upload_uniforms(Frame& frame);
+
+    template<typename F>
+    void submit_immediately(F f);
+
     Swapchain m_swapchain = {};
+    Image m_render_target = {};
+    // Stays undefined until a frame is rendered into the target
+    VkImageLayout m_render_target_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    // RGB holds the sum of traced radiance, A holds the number of samples
+    Image m_accumulation = {};
+    uint32_t m_accumulated_frames = 0;
+    std::vector<std::vector<uint8_t>> m_snapshots = {};
+    std::vector<MeshDraw> m_mesh_draws = {};
 
-    VkCommandPool m_command_pool = VK_NULL_HANDLE;
+    // Dynamic offsets are consumed in binding order, which may differ from pass order
+    std::vector<UniformBuffer> m_uniform_buffers = {};
+    std::vector<uint32_t> m_uniform_binding_order = {};
 
     VmaAllocator m_allocator = VK_NULL_HANDLE;
+    Uploader m_uploader = {};
 
-    VkSemaphore m_rendering_finished = VK_NULL_HANDLE;
-    VkSemaphore m_next_image_acquired = VK_NULL_HANDLE;
-    VkFence m_gpu_work_finished = VK_NULL_HANDLE;
+    std::array<Frame, FRAMES_IN_FLIGHT> m_frames = {};
+    uint32_t m_frame_index = 0;
+
+    // Graphics and compute queues may belong to different families, which can't share pools
+    CommandRecorder m_graphics_commands = {};
+    CommandRecorder m_compute_commands = {};
 
     DescriptorSetAllocator m_descriptor_set_allocator = {};
-    DescriptorSet m_descriptor_set = {};
-    std::vector<Buffer> m_descriptor_set_buffers = {};
+    std::vector<Buffer> m_storage_buffers = {};
+
+    GpuProfiler m_profiler = {};
+
+    // Cleared on resize, which makes the composite pass re-record
+    RenderPassCache m_render_passes = {};
 
+    PipelineCache m_pipeline_cache = {};
+    ComputePipeline m_path_tracer = {};
     GraphicsPipeline m_pipeline = {};
     GraphicsPipeline m_mesh_pipeline = {};
 
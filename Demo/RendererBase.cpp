@@ -1,22 +1,55 @@
 #include <Demo/Common/Log.h>
+#include <Demo/Config.h>
 #include <Demo/RendererBase.h>
-#include <windows.h>
+
+#define GLFW_INCLUDE_NONE
+#include <GLFW/glfw3.h>
 
 #include <algorithm>
+#include <string_view>
 #include <vector>
 
 namespace Demo {
-static VkInstance create_instance()
+static bool is_layer_available(const char* name)
+{
+    uint32_t count = 0;
+    vkEnumerateInstanceLayerProperties(&count, nullptr);
+    std::vector<VkLayerProperties> layers(count);
+    vkEnumerateInstanceLayerProperties(&count, layers.data());
+
+    return std::any_of(layers.begin(), layers.end(), [&](const VkLayerProperties& layer) {
+        return std::string_view(layer.layerName) == name;
+    });
+}
+
+static std::vector<const char*> surface_extensions()
+{
+    uint32_t count = 0;
+    const char** extensions = glfwGetRequiredInstanceExtensions(&count);
+    ASSERT(extensions != nullptr, "Window system doesn't support Vulkan");
+
+    return {extensions, extensions + count};
+}
+
+static VkInstance create_instance(bool headless)
 {
     std::vector<const char*> extensions = {
         VK_EXT_DEBUG_UTILS_EXTENSION_NAME,
-        VK_KHR_SURFACE_EXTENSION_NAME,
-        VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
     };
 
-    std::vector<const char*> layers = {
-        "VK_LAYER_KHRONOS_validation",
-    };
+    // Surface extensions depend on the platform (Win32, X11, Wayland, ...)
+    if (!headless) {
+        auto platform_extensions = surface_extensions();
+        extensions.insert(extensions.end(), platform_extensions.begin(), platform_extensions.end());
+    }
+
+    // Build hosts running headless jobs usually don't have the SDK installed
+    std::vector<const char*> layers;
+    if (is_layer_available("VK_LAYER_KHRONOS_validation")) {
+        layers.push_back("VK_LAYER_KHRONOS_validation");
+    } else {
+        warning("Validation layer is not available");
+    }
 
     VkApplicationInfo application_info = {
         .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -88,14 +121,8 @@ static VkDebugUtilsMessengerEXT create_debug_messenger(VkInstance instance)
 
 static VkSurfaceKHR create_surface(VkInstance instance, const Window& window)
 {
-    VkWin32SurfaceCreateInfoKHR create_info = {
-        .sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR,
-        .hinstance = GetModuleHandleA(nullptr),
-        .hwnd = static_cast<HWND>(window.raw_handle()),
-    };
-
     VkSurfaceKHR surface = VK_NULL_HANDLE;
-    auto result = vkCreateWin32SurfaceKHR(instance, &create_info, nullptr, &surface);
+    auto result = glfwCreateWindowSurface(instance, window.glfw_handle(), nullptr, &surface);
     VK_ASSERT(result);
 
     return surface;
@@ -112,6 +139,7 @@ QueueFamilies::QueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
         const auto& family = properties[family_index];
         bool supports_graphics = family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
         bool supports_compute = family.queueFlags & VK_QUEUE_COMPUTE_BIT;
+        bool supports_transfer = family.queueFlags & VK_QUEUE_TRANSFER_BIT;
 
         if (supports_graphics)
             graphics = family_index;
@@ -119,16 +147,27 @@ QueueFamilies::QueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface)
         if (supports_compute)
             compute = family_index;
 
+        // Copy engines run uploads in parallel with rendering
+        if (supports_transfer && !supports_graphics && !supports_compute)
+            transfer = family_index;
+
         VkBool32 supports_surface = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, family_index, surface, &supports_surface);
+        if (surface) {
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, family_index, surface, &supports_surface);
+        }
+
         if (supports_surface) {
             present = family_index;
         }
 
-        debug("Queue #{}: graphics={}, compute={}, present={}", family_index, supports_graphics, supports_compute, supports_surface);
+        debug("Queue #{}: graphics={}, compute={}, transfer={}, present={}", family_index, supports_graphics, supports_compute, supports_transfer, supports_surface);
     }
 
-    debug("Chosen queue families: graphics={}, compute={}, present={}", graphics, compute, present);
+    // Graphics queues always support transfers, even if they don't say so
+    if (transfer == VK_QUEUE_FAMILY_IGNORED)
+        transfer = graphics;
+
+    debug("Chosen queue families: graphics={}, compute={}, transfer={}, present={}", graphics, compute, transfer, present);
 }
 
 static std::pair<VkPhysicalDevice, QueueFamilies> select_physical_device(VkInstance instance, VkSurfaceKHR surface)
@@ -151,7 +190,8 @@ static std::pair<VkPhysicalDevice, QueueFamilies> select_physical_device(VkInsta
 
         bool has_graphics = queue_families.graphics != VK_QUEUE_FAMILY_IGNORED;
         bool has_compute = queue_families.compute != VK_QUEUE_FAMILY_IGNORED;
-        bool has_present = queue_families.present != VK_QUEUE_FAMILY_IGNORED;
+        // Headless renderer doesn't present anything
+        bool has_present = queue_families.present != VK_QUEUE_FAMILY_IGNORED || !surface;
 
         if (!(has_graphics && has_compute && has_present)) {
             continue;
@@ -178,16 +218,47 @@ std::vector<uint32_t> QueueFamilies::unique() const
     std::vector<uint32_t> families = {
         graphics,
         compute,
+        transfer,
         present,
     };
 
     std::sort(families.begin(), families.end());
     families.erase(std::unique(families.begin(), families.end()), families.end());
+    families.erase(std::remove(families.begin(), families.end(), VK_QUEUE_FAMILY_IGNORED), families.end());
 
     return families;
 }
 
-static VkDevice create_device(VkPhysicalDevice physical_device, QueueFamilies queue_families)
+static bool supports_dynamic_rendering(VkPhysicalDevice physical_device)
+{
+    uint32_t count = 0;
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> extensions(count);
+    vkEnumerateDeviceExtensionProperties(physical_device, nullptr, &count, extensions.data());
+
+    bool has_extension = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension) {
+        return std::string_view(extension.extensionName) == VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME;
+    });
+
+    if (!has_extension) {
+        return false;
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+    };
+
+    VkPhysicalDeviceFeatures2 features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &dynamic_rendering,
+    };
+
+    vkGetPhysicalDeviceFeatures2(physical_device, &features);
+
+    return dynamic_rendering.dynamicRendering == VK_TRUE;
+}
+
+static VkDevice create_device(VkPhysicalDevice physical_device, QueueFamilies queue_families, bool headless, bool dynamic_rendering)
 {
     auto families = queue_families.unique();
 
@@ -204,13 +275,27 @@ static VkDevice create_device(VkPhysicalDevice physical_device, QueueFamilies qu
         device_queue_create_infos.push_back(device_queue_create_info);
     }
 
-    std::vector<const char*> extensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+    std::vector<const char*> extensions;
+    if (!headless) {
+        extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
+
+    if (dynamic_rendering) {
+        extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR,
+        .dynamicRendering = VK_TRUE,
     };
 
+    // Imageless framebuffers are still used by the UI pass and on devices without dynamic rendering.
+    // Host query reset lets the GPU profiler reuse queries without ordering a reset command
     VkPhysicalDeviceVulkan12Features features_1_2 = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = dynamic_rendering ? &dynamic_rendering_features : nullptr,
         .imagelessFramebuffer = VK_TRUE,
+        .hostQueryReset = VK_TRUE,
     };
 
     VkDeviceCreateInfo create_info = {
@@ -232,23 +317,32 @@ static VkDevice create_device(VkPhysicalDevice physical_device, QueueFamilies qu
     return device;
 }
 
-RendererBase::RendererBase(const Window& window)
+RendererBase::RendererBase(const Window* window)
 {
+    bool headless = window == nullptr;
+
     VK_ASSERT(volkInitialize());
 
-    m_instance = create_instance();
+    m_instance = create_instance(headless);
     volkLoadInstance(m_instance);
     m_debug_messenger = create_debug_messenger(m_instance);
-    m_surface = create_surface(m_instance, window);
+    if (!headless) {
+        m_surface = create_surface(m_instance, *window);
+    }
     auto [physical_device, queue_families] = select_physical_device(m_instance, m_surface);
     m_physical_device = physical_device;
     m_queue_families = queue_families;
-    m_device = create_device(m_physical_device, m_queue_families);
+    m_dynamic_rendering = DYNAMIC_RENDERING && supports_dynamic_rendering(m_physical_device);
+    info("Dynamic rendering: {}", m_dynamic_rendering);
+    m_device = create_device(m_physical_device, m_queue_families, headless, m_dynamic_rendering);
     volkLoadDevice(m_device);
 
     vkGetDeviceQueue(m_device, m_queue_families.graphics, 0, &m_graphics);
     vkGetDeviceQueue(m_device, m_queue_families.compute, 0, &m_compute);
-    vkGetDeviceQueue(m_device, m_queue_families.present, 0, &m_present);
+    vkGetDeviceQueue(m_device, m_queue_families.transfer, 0, &m_transfer);
+    if (!headless) {
+        vkGetDeviceQueue(m_device, m_queue_families.present, 0, &m_present);
+    }
 }
 
 RendererBase::~RendererBase()
@@ -258,9 +352,19 @@ RendererBase::~RendererBase()
     }
 
     if (m_instance) {
-        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        if (m_surface) {
+            vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        }
+
         vkDestroyDebugUtilsMessengerEXT(m_instance, m_debug_messenger, nullptr);
         vkDestroyInstance(m_instance, nullptr);
     }
 }
+
+VkPhysicalDeviceProperties RendererBase::device_properties() const
+{
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(m_physical_device, &properties);
+    return properties;
+}
 }
@@ -13,6 +13,9 @@ struct QueueFamilies {
     uint32_t present = VK_QUEUE_FAMILY_IGNORED;
     uint32_t compute = VK_QUEUE_FAMILY_IGNORED;
 
+    // Dedicated DMA family if there is one, graphics family otherwise
+    uint32_t transfer = VK_QUEUE_FAMILY_IGNORED;
+
     QueueFamilies() = default;
     QueueFamilies(VkPhysicalDevice device, VkSurfaceKHR surface);
 
@@ -22,9 +25,19 @@ struct QueueFamilies {
 class RendererBase : NonCopyable {
 public:
     RendererBase() = default;
-    RendererBase(const Window& window);
+
+    // Passing nullptr creates a headless renderer which can't present
+    RendererBase(const Window* window);
     ~RendererBase();
 
+    bool headless() const { return m_surface == VK_NULL_HANDLE; }
+
+    // Identifies the device and driver in benchmark results
+    VkPhysicalDeviceProperties device_properties() const;
+
+    // Render passes begin with vkCmdBeginRenderingKHR instead of render pass objects
+    bool dynamic_rendering() const { return m_dynamic_rendering; }
+
 protected:
     VkInstance m_instance = VK_NULL_HANDLE;
     VkDebugUtilsMessengerEXT m_debug_messenger = VK_NULL_HANDLE;
@@ -34,6 +47,8 @@ protected:
     VkDevice m_device = VK_NULL_HANDLE;
     VkQueue m_graphics = VK_NULL_HANDLE;
     VkQueue m_compute = VK_NULL_HANDLE;
+    VkQueue m_transfer = VK_NULL_HANDLE;
     VkQueue m_present = VK_NULL_HANDLE;
+    bool m_dynamic_rendering = false;
 };
 }
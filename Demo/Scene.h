@@ -0,0 +1,28 @@
+#pragma once
+
+#include <Demo/Math.h>
+
+namespace Demo {
+// Layouts must match uniform and storage blocks in Shaders/pathtrace.comp
+
+struct Uniforms {
+    float time;
+    float aspect_ratio;
+    float fov;
+    float width;
+    float height;
+};
+
+struct Camera {
+    Vector4 position;
+    Vector4 look_dir;
+};
+
+// 64 bit count of traced rays, split into words because 64 bit atomics are optional
+struct RayCounter {
+    uint32_t low;
+    uint32_t high;
+
+    uint64_t rays() const { return static_cast<uint64_t>(high) << 32 | low; }
+};
+}
@@ -0,0 +1,125 @@
+#ifndef BVH_GLSL
+#define BVH_GLSL
+
+#include "intersection.glsl"
+
+// Must match structs in Demo/BVH.h
+
+struct BVHNode {
+    vec3 min;
+    uint left_first;
+    vec3 max;
+    uint primitive_count;
+};
+
+const uint PRIMITIVE_TRIANGLE = 0;
+const uint PRIMITIVE_BOX = 1;
+
+struct BVHPrimitive {
+    vec3 a;
+    uint type;
+    vec3 b;
+    float padding0;
+    vec3 c;
+    float padding1;
+    vec3 albedo;
+    float padding2;
+};
+
+layout (std430, set = 0, binding = 2) readonly buffer BVHNodes {
+    BVHNode nodes[];
+};
+
+layout (std430, set = 0, binding = 4) readonly buffer BVHPrimitives {
+    BVHPrimitive primitives[];
+};
+
+// Builder limits depth of the tree, so nearest-first traversal never pushes more than that
+const uint BVH_STACK_SIZE = 64;
+
+bool intersect(in BVHPrimitive primitive, in Ray ray, out float distance, out vec3 normal)
+{
+    if (primitive.type == PRIMITIVE_BOX) {
+        Box box = {primitive.a, primitive.b, 1.0 / primitive.b};
+        return intersect(box, ray, distance, normal);
+    }
+
+    Triangle triangle = {primitive.a, primitive.b, primitive.c};
+    return intersect(triangle, ray, distance, normal);
+}
+
+// Only reports hits closer than the incoming distance
+bool intersect_bvh(in Ray ray, inout float distance, inout vec3 normal, inout vec3 albedo)
+{
+    if (intersect_aabb(nodes[0].min, nodes[0].max, ray, distance) == FAR) {
+        return false;
+    }
+
+    uint stack[BVH_STACK_SIZE];
+    float stack_distances[BVH_STACK_SIZE];
+    uint stack_size = 0;
+
+    uint node_index = 0;
+    bool hit = false;
+
+    while (true) {
+        BVHNode node = nodes[node_index];
+
+        if (node.primitive_count > 0) {
+            for (uint i = node.left_first; i < node.left_first + node.primitive_count; i++) {
+                float primitive_distance;
+                vec3 primitive_normal;
+
+                if (intersect(primitives[i], ray, primitive_distance, primitive_normal) && primitive_distance < distance) {
+                    distance = primitive_distance;
+                    normal = primitive_normal;
+                    albedo = primitives[i].albedo;
+                    hit = true;
+                }
+            }
+        } else {
+            uint near_child = node.left_first;
+            uint far_child = node.left_first + 1;
+
+            float near_distance = intersect_aabb(nodes[near_child].min, nodes[near_child].max, ray, distance);
+            float far_distance = intersect_aabb(nodes[far_child].min, nodes[far_child].max, ray, distance);
+
+            if (far_distance < near_distance) {
+                uint child = near_child;
+                near_child = far_child;
+                far_child = child;
+
+                float child_distance = near_distance;
+                near_distance = far_distance;
+                far_distance = child_distance;
+            }
+
+            if (near_distance != FAR) {
+                if (far_distance != FAR) {
+                    stack[stack_size] = far_child;
+                    stack_distances[stack_size] = far_distance;
+                    stack_size++;
+                }
+
+                node_index = near_child;
+                continue;
+            }
+        }
+
+        // Skip nodes that are further than the closest hit found after they were pushed
+        bool found = false;
+        while (stack_size > 0 && !found) {
+            stack_size--;
+            node_index = stack[stack_size];
+            found = stack_distances[stack_size] < distance;
+        }
+
+        if (!found) {
+            break;
+        }
+    }
+
+    return hit;
+}
+
+#endif
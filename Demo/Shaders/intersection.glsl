@@ -0,0 +1,105 @@
+#ifndef INTERSECTION_GLSL
+#define INTERSECTION_GLSL
+
+// Distance reported when nothing is hit
+const float FAR = 1e30;
+
+struct Ray {
+    vec3 origin;
+    vec3 dir;
+    vec3 inv_dir;
+};
+
+struct Box {
+    vec3 center;
+    vec3 radius;
+    vec3 inv_radius;
+};
+
+struct Triangle {
+    vec3 a;
+    vec3 b;
+    vec3 c;
+};
+
+float maxf(in vec3 v)
+{
+    return max(max(v.x, v.y), v.z);
+}
+
+float minf(in vec3 v)
+{
+    return min(min(v.x, v.y), v.z);
+}
+
+// Majercik, Journal of Computer Graphics Techniques (JCGT), vol. 7, no. 3
+// http://jcgt.org/published/0007/03/04/
+bool intersect(in Box box, in Ray ray, out float distance, out vec3 normal)
+{
+    ray.origin = ray.origin - box.center;
+    float winding = (maxf(abs(ray.origin) * box.inv_radius) < 1.0) ? -1 : 1;
+    vec3 sgn = -sign(ray.dir);
+    vec3 d = box.radius * winding * sgn - ray.origin;
+    d *= ray.inv_dir;
+#define TEST(U, VW) (d.U >= 0.0) && all(lessThan(abs(ray.origin.VW + ray.dir.VW * d.U), box.radius.VW))
+    bvec3 test = bvec3(TEST(x, yz), TEST(y, zx), TEST(z, xy));
+    sgn = test.x ? vec3(sgn.x, 0, 0) : (test.y ? vec3(0, sgn.y, 0) : vec3(0, 0, test.z ? sgn.z : 0));
+#undef TEST
+    distance = (sgn.x != 0) ? d.x : ((sgn.y != 0) ? d.y : d.z);
+    normal = sgn;
+    return (sgn.x != 0) || (sgn.y != 0) || (sgn.z != 0);
+}
+
+// Moller, Trumbore, Fast, Minimum Storage Ray/Triangle Intersection
+bool intersect(in Triangle triangle, in Ray ray, out float distance, out vec3 normal)
+{
+    distance = FAR;
+    normal = vec3(0);
+
+    vec3 edge1 = triangle.b - triangle.a;
+    vec3 edge2 = triangle.c - triangle.a;
+
+    vec3 p = cross(ray.dir, edge2);
+    float determinant = dot(edge1, p);
+
+    // Ray is parallel to the triangle plane
+    if (abs(determinant) < 1e-8) {
+        return false;
+    }
+
+    float inv_determinant = 1.0 / determinant;
+
+    vec3 t = ray.origin - triangle.a;
+    float u = dot(t, p) * inv_determinant;
+    if (u < 0 || u > 1) {
+        return false;
+    }
+
+    vec3 q = cross(t, edge1);
+    float v = dot(ray.dir, q) * inv_determinant;
+    if (v < 0 || u + v > 1) {
+        return false;
+    }
+
+    distance = dot(edge2, q) * inv_determinant;
+
+    // Triangles are double sided, so the normal always faces the ray
+    normal = normalize(cross(edge1, edge2));
+    normal = dot(normal, ray.dir) > 0 ? -normal : normal;
+
+    return distance > 0;
+}
+
+// Returns distance to the nearest point of the box or FAR if it isn't hit before max_distance
+float intersect_aabb(in vec3 box_min, in vec3 box_max, in Ray ray, in float max_distance)
+{
+    vec3 t0 = (box_min - ray.origin) * ray.inv_dir;
+    vec3 t1 = (box_max - ray.origin) * ray.inv_dir;
+
+    float near = max(maxf(min(t0, t1)), 0.0);
+    float far = minf(max(t0, t1));
+
+    return (near <= far && near < max_distance) ? near : FAR;
+}
+
+#endif
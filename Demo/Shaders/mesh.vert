@@ -1,5 +1,16 @@
 #version 450
 
+// Matches VertexFormat::Packed, see Vertex::layout()
+layout (constant_id = 0) const bool PACKED_VERTICES = false;
+
+// Must match MeshPushConstants in Demo/Renderer.cpp
+layout (push_constant) uniform MeshPushConstants {
+    mat4 view_projection;
+    vec3 bounds_min;
+    float padding;
+    vec3 bounds_max;
+};
+
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 normal;
 layout (location = 2) in vec2 uv;
@@ -8,10 +19,27 @@ layout (location = 0) out vec3 v_position;
 layout (location = 1) out vec3 v_normal;
 layout (location = 2) out vec2 v_uv;
 
+vec3 decode_octahedral(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
 void main()
 {
-    v_position = position;
-    v_normal = normal;
+    vec3 p = position;
+    vec3 n = normal;
+
+    // UVs are half-floats, which vertex fetch already expands
+    if (PACKED_VERTICES) {
+        p = mix(bounds_min, bounds_max, position);
+        n = decode_octahedral(normal.xy);
+    }
+
+    v_position = p;
+    v_normal = n;
     v_uv = uv;
-    gl_Position = vec4(position, 1);
+    gl_Position = view_projection * vec4(p, 1);
 }
@@ -22,6 +22,24 @@ uint xoroshiro64star(inout RandomState s)
     return result;
 }
 
+// https://www.reedbeta.com/blog/hash-functions-for-gpu-rendering/
+uint pcg_hash(uint x)
+{
+    uint state = x * 747796405u + 2891336453u;
+    uint word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Decorrelates sequences of neighbouring pixels and consecutive frames
+RandomState seed_random(in uvec2 pixel, in uint frame_index)
+{
+    uint s0 = pcg_hash(pixel.x ^ pcg_hash(pixel.y));
+    uint s1 = pcg_hash(frame_index ^ s0);
+
+    // xoroshiro64* state must not be all zeroes
+    return RandomState(s0, s1 | 1u);
+}
+
 float bits_to_normalized_float(in uint bits)
 {
     return uintBitsToFloat((bits & 0x007FFFFFu) | 0x3F800000u) - 1.0;
@@ -12,6 +12,7 @@ public:
 
     std::pair<VkImageView, uint32_t> acquire_next_image(VkSemaphore semaphore);
     const VkSwapchainKHR* as_ptr() const { return &m_swapchain; }
+    VkImage image(uint32_t index) const { return m_swapchain_images[index]; }
 
     Swapchain(Swapchain&& other) noexcept
     {
@@ -0,0 +1,56 @@
+#include <Demo/UploadArena.h>
+
+namespace Demo {
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+UploadArena::UploadArena(VmaAllocator allocator, VkPhysicalDevice physical_device, size_t capacity)
+{
+    VkPhysicalDeviceProperties properties = {};
+    vkGetPhysicalDeviceProperties(physical_device, &properties);
+    m_uniform_alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+    auto usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+        | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+        | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+        | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+    m_buffer = Buffer(allocator, capacity, usage, VMA_MEMORY_USAGE_CPU_TO_GPU, BufferFlags::Mapped);
+}
+
+UploadSlice UploadArena::allocate(size_t size, size_t alignment)
+{
+    auto offset = align_up(m_offset, alignment);
+    ASSERT(offset + size <= m_buffer.size(), "Upload arena is out of memory");
+
+    m_offset = offset + size;
+
+    return UploadSlice{
+        .buffer = m_buffer.raw(),
+        .offset = offset,
+        .size = size,
+        .data = static_cast<uint8_t*>(m_buffer.mapped_data()) + offset,
+    };
+}
+
+UploadSlice UploadArena::allocate_uniform(size_t size)
+{
+    return allocate(size, m_uniform_alignment);
+}
+
+void UploadArena::flush()
+{
+    if (m_offset > m_flushed) {
+        m_buffer.flush(m_flushed, m_offset - m_flushed);
+        m_flushed = m_offset;
+    }
+}
+
+void UploadArena::reset()
+{
+    m_offset = 0;
+    m_flushed = 0;
+}
+}
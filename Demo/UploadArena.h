@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Demo/Buffer.h>
+#include <Demo/RendererBase.h>
+
+namespace Demo {
+struct UploadSlice {
+    VkBuffer buffer;
+    size_t offset;
+    size_t size;
+    void* data;
+};
+
+// Linear allocator for data which lives for a single frame. Every frame in
+// flight owns one arena and resets it once the GPU is done with that frame
+class UploadArena : NonCopyable {
+public:
+    UploadArena() = default;
+    UploadArena(VmaAllocator allocator, VkPhysicalDevice physical_device, size_t capacity);
+
+    // Slice stays valid until the next reset
+    UploadSlice allocate(size_t size, size_t alignment);
+
+    // Aligned so that the offset can be used as a dynamic uniform buffer offset
+    UploadSlice allocate_uniform(size_t size);
+
+    // Must be called before any work reading this frame's slices is submitted
+    void flush();
+    void reset();
+
+    VkBuffer raw() const { return m_buffer.raw(); }
+    size_t capacity() const { return m_buffer.size(); }
+    size_t used() const { return m_offset; }
+
+    UploadArena(UploadArena&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    UploadArena& operator=(UploadArena&& other) noexcept
+    {
+        swap(m_buffer, other.m_buffer);
+        swap(m_offset, other.m_offset);
+        swap(m_flushed, other.m_flushed);
+        swap(m_uniform_alignment, other.m_uniform_alignment);
+
+        return *this;
+    }
+
+private:
+    Buffer m_buffer = {};
+    size_t m_offset = 0;
+    size_t m_flushed = 0;
+    size_t m_uniform_alignment = 1;
+};
+}
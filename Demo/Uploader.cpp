@@ -0,0 +1,244 @@
+#include <Demo/Config.h>
+#include <Demo/Uploader.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace Demo {
+// Copies are split so that the ring can hold several of them in flight
+constexpr size_t CHUNK_DIVISOR = 4;
+
+// Keeps memcpy into staging memory aligned
+constexpr size_t STAGING_ALIGNMENT = 16;
+
+static size_t align_up(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+Uploader::Uploader(VkDevice device, VmaAllocator allocator, const QueueFamilies& queue_families, VkQueue transfer_queue, size_t staging_size)
+{
+    m_device = device;
+    m_queue = transfer_queue;
+
+    m_queue_families = {queue_families.graphics, queue_families.transfer};
+    std::sort(m_queue_families.begin(), m_queue_families.end());
+    m_queue_families.erase(std::unique(m_queue_families.begin(), m_queue_families.end()), m_queue_families.end());
+
+    VkCommandPoolCreateInfo create_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+        .queueFamilyIndex = queue_families.transfer,
+    };
+
+    auto result = vkCreateCommandPool(m_device, &create_info, nullptr, &m_command_pool);
+    VK_ASSERT(result);
+
+    m_staging = Buffer(allocator, staging_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY, BufferFlags::Mapped);
+}
+
+Uploader::~Uploader()
+{
+    if (m_device) {
+        submit();
+        wait_idle();
+
+        for (auto fence : m_free_fences) {
+            vkDestroyFence(m_device, fence, nullptr);
+        }
+
+        vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+    }
+}
+
+UploadTicket Uploader::upload(const Buffer& destination, const void* data, size_t size, size_t destination_offset)
+{
+    ASSERT(destination_offset + size <= destination.size(), "Upload is out of buffer bounds");
+
+    auto chunk_size = std::max<size_t>(m_staging.size() / CHUNK_DIVISOR, STAGING_ALIGNMENT);
+    auto* bytes = static_cast<const uint8_t*>(data);
+
+    for (size_t offset = 0; offset < size; offset += chunk_size) {
+        auto copy_size = std::min(chunk_size, size - offset);
+        auto staging_offset = allocate_staging(copy_size);
+
+        memcpy(static_cast<uint8_t*>(m_staging.mapped_data()) + staging_offset, bytes + offset, copy_size);
+
+        VkBufferCopy region = {
+            .srcOffset = staging_offset,
+            .dstOffset = destination_offset + offset,
+            .size = copy_size,
+        };
+
+        vkCmdCopyBuffer(m_recording.command_buffer, m_staging.raw(), destination.raw(), 1, &region);
+    }
+
+    // Nothing was recorded for an empty upload
+    if (size == 0) {
+        return m_completed_ticket;
+    }
+
+    return m_recording.ticket;
+}
+
+void Uploader::submit()
+{
+    if (m_recording.command_buffer == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Writes of all copies in this batch must be flushed before the transfer reads them
+    m_staging.flush(0, VK_WHOLE_SIZE);
+
+    VK_ASSERT(vkEndCommandBuffer(m_recording.command_buffer));
+
+    if (m_free_fences.empty()) {
+        VkFenceCreateInfo create_info = {
+            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        };
+
+        VkFence fence = VK_NULL_HANDLE;
+        VK_ASSERT(vkCreateFence(m_device, &create_info, nullptr, &fence));
+        m_free_fences.push_back(fence);
+    }
+
+    m_recording.fence = m_free_fences.back();
+    m_free_fences.pop_back();
+
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &m_recording.command_buffer,
+    };
+
+    VK_ASSERT(vkQueueSubmit(m_queue, 1, &submit_info, m_recording.fence));
+
+    m_in_flight.push_back(m_recording);
+    m_recording = {};
+}
+
+bool Uploader::is_complete(UploadTicket ticket)
+{
+    retire_completed();
+
+    return ticket <= m_completed_ticket;
+}
+
+void Uploader::wait(UploadTicket ticket)
+{
+    if (ticket == m_recording.ticket) {
+        submit();
+    }
+
+    while (m_completed_ticket < ticket && !m_in_flight.empty()) {
+        retire_oldest();
+    }
+}
+
+void Uploader::wait_idle()
+{
+    while (!m_in_flight.empty()) {
+        retire_oldest();
+    }
+}
+
+size_t Uploader::allocate_staging(size_t size)
+{
+    auto capacity = m_staging.size();
+    size = align_up(size, STAGING_ALIGNMENT);
+    ASSERT(size <= capacity);
+
+    while (true) {
+        if (m_used == 0) {
+            m_head = 0;
+        }
+
+        // Oldest byte still in use, which is where the head would run into
+        auto tail = (m_head + capacity - m_used) % capacity;
+        bool wrapped = m_used > 0 && tail >= m_head;
+
+        size_t skipped = 0;
+        bool fits = false;
+
+        if (!wrapped) {
+            if (m_head + size <= capacity) {
+                fits = true;
+            } else if (size <= tail) {
+                skipped = capacity - m_head;
+                fits = true;
+            }
+        } else {
+            fits = m_head + size <= tail;
+        }
+
+        if (fits) {
+            if (skipped > 0) {
+                m_head = 0;
+            }
+
+            auto offset = m_head;
+            m_head = (m_head + size) % capacity;
+            m_used += skipped + size;
+
+            if (m_recording.command_buffer == VK_NULL_HANDLE) {
+                begin_batch();
+            }
+
+            m_recording.staging_bytes += skipped + size;
+
+            return offset;
+        }
+
+        // Ring is full, so the oldest copies have to finish first
+        if (m_in_flight.empty()) {
+            submit();
+        }
+
+        retire_oldest();
+    }
+}
+
+void Uploader::begin_batch()
+{
+    VkCommandBufferAllocateInfo allocate_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        .commandPool = m_command_pool,
+        .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        .commandBufferCount = 1,
+    };
+
+    VK_ASSERT(vkAllocateCommandBuffers(m_device, &allocate_info, &m_recording.command_buffer));
+
+    VkCommandBufferBeginInfo begin_info = {
+        .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+    };
+
+    VK_ASSERT(vkBeginCommandBuffer(m_recording.command_buffer, &begin_info));
+
+    m_recording.ticket = m_next_ticket++;
+}
+
+void Uploader::retire_completed()
+{
+    while (!m_in_flight.empty() && vkGetFenceStatus(m_device, m_in_flight.front().fence) == VK_SUCCESS) {
+        retire_oldest();
+    }
+}
+
+void Uploader::retire_oldest()
+{
+    auto batch = m_in_flight.front();
+    m_in_flight.pop_front();
+
+    VK_ASSERT(vkWaitForFences(m_device, 1, &batch.fence, VK_TRUE, TIMEOUT));
+    VK_ASSERT(vkResetFences(m_device, 1, &batch.fence));
+    m_free_fences.push_back(batch.fence);
+
+    vkFreeCommandBuffers(m_device, m_command_pool, 1, &batch.command_buffer);
+
+    // Batches complete in submission order, so their staging memory is freed in order too
+    m_used -= batch.staging_bytes;
+    m_completed_ticket = batch.ticket;
+}
+}
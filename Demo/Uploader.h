@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Demo/Buffer.h>
+#include <Demo/RendererBase.h>
+
+#include <deque>
+#include <vector>
+
+namespace Demo {
+// Identifies a batch of copies, see Uploader::is_complete()
+using UploadTicket = uint64_t;
+
+// Copies host data into device local buffers through a staging ring buffer.
+// Copies are recorded into batches, which are submitted to the transfer queue
+// and retired by polling their fences, so rendering never waits for them
+class Uploader : NonCopyable {
+public:
+    Uploader() = default;
+    Uploader(VkDevice device, VmaAllocator allocator, const QueueFamilies& queue_families, VkQueue transfer_queue, size_t staging_size);
+    ~Uploader();
+
+    // Data is copied into the staging buffer before this returns. Waits for
+    // earlier batches only when the staging buffer is full
+    UploadTicket upload(const Buffer& destination, const void* data, size_t size, size_t destination_offset = 0);
+
+    // Submits copies recorded so far
+    void submit();
+
+    bool is_complete(UploadTicket ticket);
+    void wait(UploadTicket ticket);
+    void wait_idle();
+
+    // Device local buffers written by the uploader must be shared with these families
+    const std::vector<uint32_t>& queue_families() const { return m_queue_families; }
+
+    Uploader(Uploader&& other) noexcept
+    {
+        *this = move(other);
+    }
+
+    Uploader& operator=(Uploader&& other) noexcept
+    {
+        swap(m_device, other.m_device);
+        swap(m_queue, other.m_queue);
+        swap(m_command_pool, other.m_command_pool);
+        swap(m_queue_families, other.m_queue_families);
+        swap(m_staging, other.m_staging);
+        swap(m_head, other.m_head);
+        swap(m_used, other.m_used);
+        swap(m_recording, other.m_recording);
+        swap(m_in_flight, other.m_in_flight);
+        swap(m_free_fences, other.m_free_fences);
+        swap(m_next_ticket, other.m_next_ticket);
+        swap(m_completed_ticket, other.m_completed_ticket);
+
+        return *this;
+    }
+
+private:
+    struct Batch {
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        VkFence fence = VK_NULL_HANDLE;
+        size_t staging_bytes = 0; // Including bytes skipped when the ring wrapped around
+        UploadTicket ticket = 0;
+    };
+
+    size_t allocate_staging(size_t size);
+    void begin_batch();
+    void retire_completed();
+    void retire_oldest();
+
+    VkDevice m_device = VK_NULL_HANDLE;
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VkCommandPool m_command_pool = VK_NULL_HANDLE;
+    std::vector<uint32_t> m_queue_families = {};
+
+    Buffer m_staging = {};
+    size_t m_head = 0;
+    size_t m_used = 0;
+
+    Batch m_recording = {};
+    std::deque<Batch> m_in_flight = {};
+    std::vector<VkFence> m_free_fences = {};
+
+    UploadTicket m_next_ticket = 1;
+    UploadTicket m_completed_ticket = 0;
+};
+}
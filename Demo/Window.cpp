@@ -2,25 +2,22 @@
 #include <Demo/Window.h>
 #include <GLFW/glfw3.h>
 
-#define GLFW_EXPOSE_NATIVE_WIN32
-#include <GLFW/glfw3native.h>
-
 namespace Demo {
-static void resize_callback(GLFWwindow* window, int width, int height)
+void resize_callback(GLFWwindow* window, int width, int height)
 {
     auto* w = static_cast<Window*>(glfwGetWindowUserPointer(window));
 
     w->m_resize_handler(Vector2u(static_cast<uint32_t>(width), static_cast<uint32_t>(height)));
 }
 
-static void mouse_move_callback(GLFWwindow* window, double x, double y)
+void mouse_move_callback(GLFWwindow* window, double x, double y)
 {
     auto* w = static_cast<Window*>(glfwGetWindowUserPointer(window));
 
     w->m_mouse_move_handler(static_cast<float>(x), static_cast<float>(y));
 }
 
-static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     auto* w = static_cast<Window*>(glfwGetWindowUserPointer(window));
 
@@ -53,11 +50,6 @@ bool Window::close_requested() const
     return glfwWindowShouldClose(m_window);
 }
 
-void* Window::raw_handle() const
-{
-    return glfwGetWin32Window(m_window);
-}
-
 GLFWwindow* Window::glfw_handle() const
 {
     return m_window;
@@ -22,7 +22,6 @@ public:
     ~Window();
 
     bool close_requested() const;
-    void* raw_handle() const;
     GLFWwindow* glfw_handle() const;
     bool key_pressed(int key) const;
     Vector2u size() const;